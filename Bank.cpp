@@ -146,6 +146,13 @@ Bank::Bank(
 		row(0),
 		currentRequestValid(false),
 		nextPipelineEvent(0),
+		eventLog(engineArg->getEventLog()),
+		logTrack(0),
+		logQueue(0),
+		logOpen(0),
+		logClose(0),
+		logService(0),
+		stateTimestamp(0),
 		queueTime(statCont, nameArg + "_queue_time", "Number of cycles requests for " + descArg + " spend in the queue", 0),
 		openTime(statCont, nameArg + "_open_time", "Number of cycles " + descArg + " spends opening rows for requests", 0),
 		accessTime(statCont, nameArg + "_access_time", "Number of cycles " + descArg + " spends accessing rows for requests", 0),
@@ -175,6 +182,13 @@ Bank::Bank(
 	//debugStart = 120000000;
 	//debugStart = 0;
 
+	if (eventLog != 0){
+		logTrack = eventLog->addTrack(name);
+		logQueue = eventLog->addName("queue");
+		logOpen = eventLog->addName("open");
+		logClose = eventLog->addName("close");
+		logService = eventLog->addName("service");
+	}
 }
 
 bool Bank::access(MemoryRequest *request, IMemoryCallback *caller){
@@ -239,6 +253,12 @@ bool Bank::access(MemoryRequest *request, IMemoryCallback *caller){
 void Bank::changeState(){
 	uint64 timestamp = engine->getTimestamp();
 	debug(": state: %d", state);
+	State oldState = state;
+	if (state == OPENING){
+		logSpan(logOpen, stateTimestamp, timestamp, currentRequest.request);
+	} else if (state == CLOSING){
+		logSpan(logClose, stateTimestamp, timestamp, currentRequestValid ? currentRequest.request : 0);
+	}
 	if (state == CLOSED){
 		selectNextRequest();
 		state = OPENING;
@@ -337,12 +357,15 @@ void Bank::changeState(){
 				numReadRequests++;
 				readQueueTime += (oldRequest.dequeueTimestamp - oldRequest.enqueueTimestamp);
 				readTotalTime += (timestamp - oldRequest.enqueueTimestamp);
+				memory->recordTotalTime(true, timestamp - oldRequest.enqueueTimestamp);
 			} else {
 				numWriteRequests++;
 				writeQueueTime += (oldRequest.dequeueTimestamp - oldRequest.enqueueTimestamp);
 				writeTotalTime += (timestamp - oldRequest.enqueueTimestamp);
+				memory->recordTotalTime(false, timestamp - oldRequest.enqueueTimestamp);
 			}
 			queueTime += (oldRequest.dequeueTimestamp - oldRequest.enqueueTimestamp);
+			logSpan(logService, oldRequest.serviceTimestamp, timestamp, oldRequest.request);
 			memory->accessCompleted(oldRequest.request, this);
 		}
 	} else if (state == OPEN_DIRTY){
@@ -413,12 +436,15 @@ void Bank::changeState(){
 				numReadRequests++;
 				readQueueTime += (oldRequest.dequeueTimestamp - oldRequest.enqueueTimestamp);
 				readTotalTime += (timestamp - oldRequest.enqueueTimestamp);
+				memory->recordTotalTime(true, timestamp - oldRequest.enqueueTimestamp);
 			} else {
 				numWriteRequests++;
 				writeQueueTime += (oldRequest.dequeueTimestamp - oldRequest.enqueueTimestamp);
 				writeTotalTime += (timestamp - oldRequest.enqueueTimestamp);
+				memory->recordTotalTime(false, timestamp - oldRequest.enqueueTimestamp);
 			}
 			queueTime += (oldRequest.dequeueTimestamp - oldRequest.enqueueTimestamp);
+			logSpan(logService, oldRequest.serviceTimestamp, timestamp, oldRequest.request);
 			memory->accessCompleted(oldRequest.request, this);
 		}
 	} else if (state == CLOSING){
@@ -448,6 +474,9 @@ void Bank::changeState(){
 	} else {
 		error("Wrong bank state");
 	}
+	if (state != oldState){
+		stateTimestamp = timestamp;
+	}
 }
 
 void Bank::process(const Event *event) {
@@ -565,6 +594,8 @@ void Bank::process(const Event *event) {
 					numAccesses++;
 					debug("\tcurrent request addr: %lu", pipelineRequests.back().request->addr);
 					pipelineRequests.back().request->counters[queueCounterIndex] = timestamp - pipelineRequests.back().request->counters[queueCounterIndex];
+					pipelineRequests.back().serviceTimestamp = timestamp;
+					logSpan(logQueue, pipelineRequests.back().enqueueTimestamp, timestamp, pipelineRequests.back().request);
 				} else {
 					if (defer){
 						nextPipelineEvent = timestamp + bus->getLatency();
@@ -682,6 +713,8 @@ void Bank::selectNextRequest(){
 		}
 
 		currentRequest.dequeueTimestamp = timestamp;
+		currentRequest.serviceTimestamp = timestamp;
+		logSpan(logQueue, currentRequest.enqueueTimestamp, timestamp, currentRequest.request);
 		currentRequest.request->counters[queueCounterIndex] = timestamp - currentRequest.request->counters[queueCounterIndex];
 		currentRequestValid = true;
 	}
@@ -703,6 +736,23 @@ void Bank::notify(MemoryRequest * request) {
 }
 
 
+/*
+ * Only the row buffer is saved, since there are no requests in flight when a checkpoint is taken
+ */
+void Bank::saveCheckpoint(CheckpointWriter *cp){
+	myassert(!currentRequestValid && pipelineRequests.empty());
+	myassert(state == CLOSED || state == OPEN_CLEAN || state == OPEN_DIRTY);
+	cp->write(state);
+	cp->write(row);
+	cp->write(dirtyColumns);
+}
+
+void Bank::restoreCheckpoint(CheckpointReader *cp){
+	cp->read(&state);
+	cp->read(&row);
+	cp->read(&dirtyColumns);
+}
+
 istream& operator>>(istream& lhs, RowBufferPolicy& rhs){
 	string s;
 	lhs >> s;
@@ -18,10 +18,15 @@ Bus::Bus(const string& nameArg,
 				engine(engineArg),
 				debugStart(debugStartArg),
 
-				latency(latencyArg) {
+				latency(latencyArg),
+				eventLog(engineArg->getEventLog()),
+				logTrack(0) {
 	//debugStart = 121000000;
 	//debugStart = 0;
 
+	if (eventLog != 0){
+		logTrack = eventLog->addTrack(name);
+	}
 }
 
 uint64 Bus::schedule(uint64 delay, IBusCallback *caller){
@@ -46,6 +51,13 @@ uint64 Bus::schedule(uint64 delay, IBusCallback *caller){
 	}
 	debug(": \tscheduled bus at : %lu (callback at %lu)", actualDelay+timestamp, actualDelay+latency+timestamp);
 	engine->addEvent(actualDelay+latency, this);
+	if (eventLog != 0){
+		unordered_map<IBusCallback *, uint32>::iterator it = logNames.find(caller);
+		if (it == logNames.end()){
+			it = logNames.emplace(caller, eventLog->addName(string("transfer ") + caller->getName())).first;
+		}
+		eventLog->record(logTrack, it->second, timestamp + actualDelay, timestamp + actualDelay + latency, 0, 0);
+	}
 	return actualDelay;
 }
 
@@ -5,6 +5,7 @@
  */
 
 #include "CPU.H"
+#include "Profiler.H"
 
 #include <cmath>
 
@@ -27,7 +28,12 @@ OOOCPU::OOOCPU(Engine *engineArg,
 		CPU(engineArg, nameArg, descArg, debugStartArg, statCont, coreIdArg, pidArg, managerArg, instrCacheArg, dataCacheArg, readerArg, blockSizeArg, instrLimitArg),
 				robSize(robSizeArg),
 				issueWidth(issueWidthArg),
+				eventLog(engineArg->getEventLog()),
+				logTrack(0),
+				logInstr(0),
+				logData(0),
 				instrTotalTime(statCont, nameArg + "_instr_total_time", "Number of cycles of " + descArg + " instruction requests", 0),
+				instrTimeHistogram(statCont, nameArg + "_instr_latency", "Number of cycles of " + descArg + " instruction requests"),
 				instrL1WaitTime(statCont, nameArg + "_instr_L1_wait_time", "Number of cycles " + descArg + " instruction requests wait for requests to the same block in the L1", 0),
 				instrL2WaitTime(statCont, nameArg + "_instr_L2_wait_time", "Number of cycles " + descArg + " instruction requests wait for requests to the same block in the L2", 0),
 				instrCpuPauseTime(statCont, nameArg + "_instr_cpu_pause_time", "Number of cycles " + descArg + " instruction requests pause at CPU", 0),
@@ -61,6 +67,7 @@ OOOCPU::OOOCPU(Engine *engineArg,
 				instrPcmAccessCount(statCont, nameArg + "_instr_pcm_access_count", "Number of " + descArg + " instruction requests that access a PCM row", 0),
 
 				dataTotalTime(statCont, nameArg + "_data_total_time", "Number of cycles of " + descArg + " data requests", 0),
+				dataTimeHistogram(statCont, nameArg + "_data_latency", "Number of cycles of " + descArg + " data requests"),
 				dataL1WaitTime(statCont, nameArg + "_data_L1_wait_time", "Number of cycles " + descArg + " data requests wait for requests to the same block in the L1", 0),
 				dataL2WaitTime(statCont, nameArg + "_data_L2_wait_time", "Number of cycles " + descArg + " data requests wait for requests to the same block in the L2", 0),
 				dataCpuPauseTime(statCont, nameArg + "_data_cpu_pause_time", "Number of cycles " + descArg + " data requests pause at CPU", 0),
@@ -105,6 +112,12 @@ OOOCPU::OOOCPU(Engine *engineArg,
 
 	eventScheduled[0] = false;
 	eventScheduled[1] = false;
+
+	if (eventLog != 0){
+		logTrack = eventLog->addTrack(name);
+		logInstr = eventLog->addName("instruction fetch");
+		logData = eventLog->addName("data read");
+	}
 	resumed[0] = false;
 	resumed[1] = false;
 	instrUnstall[0] = false;
@@ -498,7 +511,7 @@ void OOOCPU::fetch(){
 	if (fetchNext && nextEntryValid && !robFull && instrPausers.empty() && stalledInstrRequests.empty() && stalledDataRequests.empty()){
 		numFetchEntries = 0;
 		nextFetchEntry = 0;
-		while(nextEntryValid && !robFull && numFetchEntries < issueWidth){
+		while(nextEntryValid && !robFull && numFetchEntries < issueWidth && (sampler == 0 || sampler->isDetailed())){
 			RobEntry *robHeadPtr = &rob[robHead];
 			uint8 num_instr = 0;
 			robHeadPtr->numData = 0;
@@ -585,6 +598,10 @@ void OOOCPU::commit(){
 		scheduleEvent();
 	}
 
+	if (sampler != 0 && !sampler->isDetailed() && nextEntryValid && robHead == robTail && !robFull && stalledInstrRequests.empty() && stalledDataRequests.empty()){
+		sample();
+	}
+
 //	unsigned usedEntries;
 //	if (robHead > robTail){
 //		usedEntries = robHead - robTail;
@@ -608,12 +625,46 @@ void OOOCPU::scheduleEvent(){
 	}
 }
 
+/*
+ * Called when a sampling window has ended and the ROB has drained. The instruction entry read last (which went over the window)
+ * is the first one of the functional warmup.
+ */
+void OOOCPU::sample(){
+	instrExecuted--;
+	if (sampler->getPhase() == Sampler::DONE){
+		nextEntryValid = false;
+		manager->finish(coreId);
+		return;
+	}
+	functionalAccess(firstEntry);
+	if (secondEntryValid){
+		functionalAccess(secondEntry);
+		secondEntryValid = false;
+	}
+	uint64 warmed = fastForward(min(sampler->getFunctionalLength() - 1, instrLimit - numInstr), true);
+	numInstr += warmed;
+	sampler->addFunctionalInstructions(warmed + 1);
+	sampler->startDetailed();
+	nextEntryValid = readNextEntry();
+	if (nextEntryValid){
+		currentTraceTimestamp = firstEntry.timestamp;
+		scheduleEvent();
+	} else {
+		manager->finish(coreId);
+	}
+}
+
 void OOOCPU::addEvent(uint64 delay, EventType type){
 	engine->addEvent(delay, this, type);
 }
 
 void OOOCPU::countInstr(MemoryRequest *request){
+	if (eventLog != 0){
+		uint64 end = engine->getTimestamp() - 1;
+		eventLog->record(logTrack, logInstr, end - request->counters[TOTAL], end, reinterpret_cast<uint64>(request), request->addr);
+	}
 	instrTotalTime += request->counters[0];
+	instrTimeHistogram.record(request->counters[0]);
 	instrL1WaitTime += request->counters[1];
 	instrL2WaitTime += request->counters[2];
 	instrCpuPauseTime += request->counters[3];
@@ -646,7 +697,15 @@ void OOOCPU::countInstr(MemoryRequest *request){
 }
 
 void OOOCPU::countData(MemoryRequest *request){
+	if (sampler != 0){
+		sampler->addLatency(request->counters[TOTAL]);
+	}
+	if (eventLog != 0){
+		uint64 end = engine->getTimestamp() - 1;
+		eventLog->record(logTrack, logData, end - request->counters[TOTAL], end, reinterpret_cast<uint64>(request), request->addr);
+	}
 	dataTotalTime += request->counters[0];
+	dataTimeHistogram.record(request->counters[0]);
 	dataL1WaitTime += request->counters[1];
 	dataL2WaitTime += request->counters[2];
 	dataCpuPauseTime += request->counters[3];
@@ -812,10 +871,15 @@ CPU::CPU(Engine *engineArg,
 	}
 
 	numInstr = 0;
+	entriesRead = 0;
+	recountedInstr = 0;
 
 	startPauseTimestamp = 0;
 
 	secondEntryValid = false;
+	unreadEntryValid = false;
+
+	sampler = 0;
 
 }
 
@@ -824,7 +888,7 @@ bool CPU::readNextEntry(){
 		firstEntry = secondEntry;
 		secondEntryValid = false;
 	} else {
-		if (reader->readEntry(&firstEntry)){
+		if (readEntry(&firstEntry)){
 			addrint firstByteBlockAddress = firstEntry.address & ~offsetMask;
 			addrint lastByteBlockAddress = (firstEntry.address + firstEntry.size - 1) & ~offsetMask;
 			if (firstByteBlockAddress == lastByteBlockAddress){
@@ -846,7 +910,14 @@ bool CPU::readNextEntry(){
 			if (firstEntry.instr){
 				numInstr++;
 				instrCounter++;
-				instrExecuted++;
+				if (recountedInstr == 0){
+					instrExecuted++;
+				} else {
+					recountedInstr--;
+				}
+				if (sampler != 0){
+					(*sampler->getCounter())++;
+				}
 			}
 		} else {
 			return false;
@@ -859,3 +930,117 @@ bool CPU::readNextEntry(){
 		return true;
 	}
 }
+
+bool CPU::readEntry(TraceEntry *entry){
+	if (unreadEntryValid){
+		*entry = unreadEntryBuffer;
+		unreadEntryValid = false;
+	} else {
+		ProfileScope scope(engine->getProfiler(), "trace reading");
+		if (!reader->readEntry(entry)){
+			return false;
+		}
+	}
+	entriesRead++;
+	return true;
+}
+
+void CPU::unreadEntry(const TraceEntry& entry){
+	myassert(!unreadEntryValid);
+	unreadEntryBuffer = entry;
+	unreadEntryValid = true;
+	entriesRead--;
+}
+
+/*
+ * The following functions must be called before start(). They stop before the instruction entry that follows
+ * the given number of instructions, so that the simulation starts with an instruction and not with its data accesses
+ */
+void CPU::skipInstructions(uint64 numInstructions){
+	uint64 instr = fastForward(numInstructions, false);
+	if (instr < numInstructions){
+		error("The trace of %s ends before the simulation starts (%lu instructions skipped)", name.c_str(), instr);
+	}
+}
+
+void CPU::warmUp(uint64 numInstructions){
+	uint64 instr = fastForward(numInstructions, true);
+	if (instr < numInstructions){
+		error("The trace of %s ends before the simulation starts (%lu instructions skipped)", name.c_str(), instr);
+	}
+}
+
+/*
+ * Returns the number of instructions fast forwarded, which is less than numInstructions only if the trace ends
+ */
+uint64 CPU::fastForward(uint64 numInstructions, bool warm){
+	TraceEntry entry;
+	uint64 instr = 0;
+	while (readEntry(&entry)){
+		if (entry.instr){
+			if (instr == numInstructions){
+				unreadEntry(entry);
+				return instr;
+			}
+			instr++;
+		}
+		if (warm){
+			functionalAccess(entry);
+		}
+	}
+	return instr;
+}
+
+void CPU::functionalAccess(const TraceEntry& entry){
+	IMemory *cache = entry.instr ? instrCache : dataCache;
+	addrint firstByteBlockAddress = entry.address & ~offsetMask;
+	addrint lastByteBlockAddress = (entry.address + entry.size - 1) & ~offsetMask;
+	cache->functionalAccess(manager->functionalAccess(pid, firstByteBlockAddress, entry.read, entry.instr), entry.read, entry.instr);
+	if (firstByteBlockAddress != lastByteBlockAddress){
+		cache->functionalAccess(manager->functionalAccess(pid, lastByteBlockAddress, entry.read, entry.instr), entry.read, entry.instr);
+	}
+}
+
+void CPU::stopFetching(){
+	if (numInstr < instrLimit){
+		instrLimit = numInstr;
+	}
+}
+
+/*
+ * The position in the trace is saved as the number of entries read. The entry that went over the instruction limit
+ * was read but not executed, so it is left out of the saved position and read again after restoring. The saved statistics
+ * already count it, so it is not counted again when it is read.
+ */
+void CPU::saveCheckpoint(CheckpointWriter *cp){
+	uint64 entries = entriesRead;
+	uint64 instr = numInstr;
+	uint64 excluded = 0;
+	if (numInstr > instrLimit){
+		entries--;
+		instr--;
+		excluded = 1;
+	}
+	cp->write(entries);
+	cp->write(instr);
+	cp->write(excluded);
+	instrCounter.saveCheckpoint(cp, excluded);
+}
+
+/*
+ * Must be called before start()
+ */
+bool CPU::restoreCheckpoint(CheckpointReader *cp){
+	myassert(entriesRead == 0);
+	uint64 entries = cp->read<uint64>();
+	cp->read(&numInstr);
+	cp->read(&recountedInstr);
+	instrCounter.restoreCheckpoint(cp);
+	TraceEntry entry;
+	while (entriesRead < entries){
+		if (!readEntry(&entry)){
+			error("The trace of %s ends before the position it was checkpointed at (%lu entries)", name.c_str(), entries);
+		}
+	}
+	return true;
+}
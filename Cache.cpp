@@ -169,6 +169,19 @@ void Set::makeDirty(addrint tag){
 	warn("Trying to make dirty a block that was not present");
 }
 
+void Set::saveCheckpoint(CheckpointWriter *cp){
+	assert(pinnedBlocks.empty());
+	for (unsigned i = 0; i < numBlocks; i++){
+		cp->write(blocks[i]);
+	}
+}
+
+void Set::restoreCheckpoint(CheckpointReader *cp){
+	for (unsigned i = 0; i < numBlocks; i++){
+		cp->read(&blocks[i]);
+	}
+}
+
 
 
 CacheModel::CacheModel(const string& nameArg, const string& descArg, StatContainer *statCont, uint64 cacheSizeArg, unsigned blockSizeArg, unsigned setAssocArg, CacheReplacementPolicy policyArg, unsigned pageSizeArg) :
@@ -257,6 +270,55 @@ CacheModel::~CacheModel(){
 }
 
 CacheModel::Result CacheModel::access(addrint addr, bool read, bool instr, addrint *evictedAddr, addrint *internalAddr){
+	int block;
+	addrint index;
+	Result ret = lookup(addr, read, evictedAddr, &block, &index);
+	if (ret == HIT){
+		hits++;
+		if (read){
+			if (instr){
+				instrLoadHits++;
+			} else {
+				dataLoadHits++;
+			}
+		} else {
+			dataStoreHits++;
+		}
+	} else {
+		if (read){
+			if (instr){
+				instrLoadMisses++;
+			} else {
+				dataLoadMisses++;
+			}
+		} else {
+			dataStoreMisses++;
+		}
+		if (ret == MISS_WITHOUT_EVICTION){
+			misses_without_eviction++;
+		} else if (ret == MISS_WITH_EVICTION){
+			misses_with_eviction++;
+		} else if (ret == MISS_WITH_WRITEBACK){
+			misses_with_writeback++;
+		} else if (ret == MISS_WITHOUT_FREE_BLOCK){
+			misses_without_free_block++;
+		} else {
+			assert(false);
+		}
+	}
+	if (internalAddr != 0){
+		*internalAddr = (block << (indexWidth + offsetWidth)) | (index << offsetWidth);
+	}
+	return ret;
+}
+
+CacheModel::Result CacheModel::functionalAccess(addrint addr, bool read, addrint *evictedAddr){
+	int block;
+	addrint index;
+	return lookup(addr, read, evictedAddr, &block, &index);
+}
+
+CacheModel::Result CacheModel::lookup(addrint addr, bool read, addrint *evictedAddr, int *block, addrint *index){
 	//debug2("CacheModel.access(%lu)", addr);
 	assert((addr & msbMask) == 0);
 	addrint actualAddr;
@@ -269,28 +331,18 @@ CacheModel::Result CacheModel::access(addrint addr, bool read, bool instr, addri
 		actualAddr = newAddr;
 	}
 
-	addrint index = getIndex(actualAddr);
+	*index = getIndex(actualAddr);
 	addrint tag = getTag(actualAddr);
 	Result ret;
 	timestamp++;
-	int block = sets[index].access(tag, timestamp, read);
-	if (block == -1){
-		if (read){
-			if (instr){
-				instrLoadMisses++;
-			} else {
-				dataLoadMisses++;
-			}
-		} else {
-			dataStoreMisses++;
-		}
+	*block = sets[*index].access(tag, timestamp, read);
+	if (*block == -1){
 		addrint tagEvicted;
-		Set::Result res = sets[index].allocate(tag, timestamp, read, policy, &tagEvicted, &block);
+		Set::Result res = sets[*index].allocate(tag, timestamp, read, policy, &tagEvicted, block);
 		if (it != remapTable.end()){
 			it->second.count++;
 		}
 		if (res == Set::NO_EVICTION){
-			misses_without_eviction++;
 			ret = MISS_WITHOUT_EVICTION;
 		} else if (res == Set::EVICTION || res == Set::WRITEBACK){
 			addrint actualEvictedAddr = (tagEvicted << (indexWidth + offsetWidth)) | ( actualAddr & ~tagMask & ~offsetMask);
@@ -316,34 +368,17 @@ CacheModel::Result CacheModel::access(addrint addr, bool read, bool instr, addri
 			}
 			assert((*evictedAddr & msbMask) == 0);
 			if (res == Set::EVICTION){
-				misses_with_eviction++;
 				ret = MISS_WITH_EVICTION;
 			} else {
-				misses_with_writeback++;
 				ret = MISS_WITH_WRITEBACK;
 			}
-		} else if (res == Set::INVALID){
-			misses_without_free_block++;
-			ret = MISS_WITHOUT_FREE_BLOCK;
 		} else {
-			assert(false);
+			assert(res == Set::INVALID);
+			ret = MISS_WITHOUT_FREE_BLOCK;
 		}
 	} else {
-		hits++;
-		if (read){
-			if (instr){
-				instrLoadHits++;
-			} else {
-				dataLoadHits++;
-			}
-		} else {
-			dataStoreHits++;
-		}
 		ret = HIT;
 	}
-	if (internalAddr != 0){
-		*internalAddr = (block << (indexWidth + offsetWidth)) | (index << offsetWidth);
-	}
 	return ret;
 }
 
@@ -362,10 +397,7 @@ void CacheModel::unpin(addrint addr){
 }
 
 Set::Result CacheModel::flush(addrint addr){
-
-	addrint index = getIndex(addr);
-	addrint tag = getTag(addr);
-	Set::Result res = sets[index].flush(tag);
+	Set::Result res = functionalFlush(addr);
 	if (res == Set::NO_EVICTION){
 		flushesWithoutEviction++;
 	} else if (res == Set::EVICTION){
@@ -378,6 +410,12 @@ Set::Result CacheModel::flush(addrint addr){
 	return res;
 }
 
+Set::Result CacheModel::functionalFlush(addrint addr){
+	addrint index = getIndex(addr);
+	addrint tag = getTag(addr);
+	return sets[index].flush(tag);
+}
+
 bool CacheModel::changeTag(addrint oldAddr, addrint newAddr){
 	//debug2("CacheModel.changeTag(%lu, %lu)", oldAddr, newAddr);
 	addrint oldIndex = getIndex(oldAddr);
@@ -446,9 +484,8 @@ bool CacheModel::remap(addrint oldPage, addrint newPage, AddrList *present, Addr
 					present->push_back(oldAddr);
 				}
 			}
-			unsigned count = present->size();
-			assert(count == it->second.count);
-			assert(count != 0);
+			assert(present->size() == it->second.count);
+			assert(!present->empty());
 			remapTable.erase(it);
 			invRemapTable.erase(itInv);
 		} else {
@@ -471,6 +508,47 @@ bool CacheModel::remap(addrint oldPage, addrint newPage, AddrList *present, Addr
 	return false;
 }
 
+void CacheModel::saveCheckpoint(CheckpointWriter *cp){
+	cp->write(numSets);
+	cp->write(setAssoc);
+	cp->write(blockSize);
+	cp->write(pageSize);
+	cp->write(timestamp);
+	for (uint64 i = 0; i < numSets; i++){
+		sets[i].saveCheckpoint(cp);
+	}
+	cp->write<uint64>(remapTable.size());
+	for (auto it = remapTable.begin(); it != remapTable.end(); ++it){
+		cp->write(it->first);
+		cp->write(it->second.addr);
+		cp->write(it->second.count);
+	}
+}
+
+/*
+ * Returns false if the geometry of the cache is different from the one the checkpoint was taken with
+ */
+bool CacheModel::restoreCheckpoint(CheckpointReader *cp){
+	if (cp->read<uint64>() != numSets || cp->read<unsigned>() != setAssoc || cp->read<unsigned>() != blockSize || cp->read<unsigned>() != pageSize){
+		return false;
+	}
+	cp->read(&timestamp);
+	for (uint64 i = 0; i < numSets; i++){
+		sets[i].restoreCheckpoint(cp);
+	}
+	remapTable.clear();
+	invRemapTable.clear();
+	uint64 numRemaps = cp->read<uint64>();
+	for (uint64 i = 0; i < numRemaps; i++){
+		addrint newPage = cp->read<addrint>();
+		addrint oldPage = cp->read<addrint>();
+		unsigned count = cp->read<unsigned>();
+		auto it = remapTable.emplace(newPage, RemapTableEntry(oldPage, count)).first;
+		invRemapTable.emplace(oldPage, InvRemapTableEntry(newPage, &it->second.count));
+	}
+	return true;
+}
+
 addrint CacheModel::getActualAddress(addrint addr) const {
 	assert((addr & msbMask) == 0);
 	auto it = remapTable.find(getPageIndex(addr));
@@ -516,6 +594,11 @@ Cache::Cache(
 		realRemap(realRemapArg),
 		queueSize(0),
 		nextStalledCaller(0),
+		eventLog(engineArg->getEventLog()),
+		logTrack(0),
+		logTagHit(0),
+		logTagMiss(0),
+		logMiss(0),
 		readAccessTime(statCont, nameArg + "_read_access_time", "Number of cycles of " + descArg + " read requests", 0),
 		missesFromFlush(statCont, nameArg + "_misses_from_flush", "Number of " + descArg + " misses from flush", 0),
 		writebacksFromFlush(statCont, nameArg + "_writebacks_from_flush", "Number of " + descArg + " writebacks from flush", 0) {
@@ -523,13 +606,20 @@ Cache::Cache(
 	accessTypeMask = 63;
 	myassert(accessTypeMask < cacheModel.getBlockSize());
 	myassert(ACCESS_TYPE_SIZE - 1 <= accessTypeMask);
+
+	if (eventLog != 0){
+		logTrack = eventLog->addTrack(name);
+		logTagHit = eventLog->addName("tag hit");
+		logTagMiss = eventLog->addName("tag miss");
+		logMiss = eventLog->addName("miss");
+	}
 }
 
 bool Cache::access(MemoryRequest *request, IMemoryCallback *caller){
 	uint64 timestamp = engine->getTimestamp();
 	debug("(%p, %lu, %u, %s, %s, %d, %s)", request, request->addr, request->size, request->read?"read":"write", request->instr?"instr":"data", request->priority, caller->getName());
 
-	if (DEBUG){
+	if (DEBUG_LEVEL >= 1){
 		for (auto it = requests.begin(); it != requests.end(); ++it){
 			debug(": timestamp: %lu,  it->first: %lu, request: %p, request->addr: %lu, waitingForFlush: %s", it->second.timestamp, it->first, it->second.request, it->second.request->addr, it->second.waitingForFlush?"true":"false");
 		}
@@ -584,7 +674,6 @@ bool Cache::access(MemoryRequest *request, IMemoryCallback *caller){
 //		}
 	}
 
-	RequestMap::iterator it = requests.find(blockAddr);
 	auto res = requests.emplace(blockAddr, Request(request));
 	if (res.second){
 		res.first->second.result = cacheModel.access(blockAddr, request->read, request->instr, &res.first->second.evictedAddr, 0);
@@ -611,7 +700,7 @@ bool Cache::access(MemoryRequest *request, IMemoryCallback *caller){
 		} else {
 			debug(": ongoing access before next level access");
 			debug(": numCallers: %lu", res.first->second.numCallers);
-			if (DEBUG){
+			if (DEBUG_LEVEL >= 1){
 				for (auto i = res.first->second.callers.begin(); i != res.first->second.callers.end(); ++i){
 					debug(": caller: %p", i->request);
 				}
@@ -625,6 +714,42 @@ bool Cache::access(MemoryRequest *request, IMemoryCallback *caller){
 	return true;
 }
 
+/*
+ * Misses are filled from the next level and evicted blocks are flushed from the previous levels (caches are inclusive).
+ * Dirty evicted blocks are written back to the next level.
+ */
+void Cache::functionalAccess(addrint addr, bool read, bool instr){
+	addrint blockAddr = cacheModel.getBlockAddress(addr);
+	addrint evictedAddr;
+	CacheModel::Result result = cacheModel.functionalAccess(blockAddr, read, &evictedAddr);
+	if (result == CacheModel::HIT){
+		return;
+	} else if (result == CacheModel::MISS_WITHOUT_FREE_BLOCK){
+		error("CacheModel::functionalAccess() returned MISS_WITHOUT_FREE_BLOCK");
+	}
+	nextLevel->functionalAccess(blockAddr, true, instr);
+	if (result == CacheModel::MISS_WITH_EVICTION || result == CacheModel::MISS_WITH_WRITEBACK){
+		bool dirty = result == CacheModel::MISS_WITH_WRITEBACK;
+		for (CacheList::iterator itCache = prevLevels.begin(); itCache != prevLevels.end(); itCache++){
+			dirty = (*itCache)->functionalFlush(evictedAddr) || dirty;
+		}
+		if (dirty){
+			nextLevel->functionalAccess(evictedAddr, false, false);
+		}
+	}
+}
+
+/*
+ * Returns whether the block was dirty in this cache or in any of the previous levels
+ */
+bool Cache::functionalFlush(addrint addr){
+	bool dirty = false;
+	for (CacheList::iterator itCache = prevLevels.begin(); itCache != prevLevels.end(); itCache++){
+		dirty = (*itCache)->functionalFlush(addr) || dirty;
+	}
+	return cacheModel.functionalFlush(addr) == Set::WRITEBACK || dirty;
+}
+
 void Cache::accessCompleted(MemoryRequest *request, IMemory *caller){
 	uint64 timestamp = engine->getTimestamp();
 	debug("(%p, %lu, %s)", request, request->addr, caller->getName());
@@ -636,6 +761,9 @@ void Cache::accessCompleted(MemoryRequest *request, IMemory *caller){
 	myassert(it != requests.end());
 
 	readAccessTime += (timestamp - it->second.timestamp);
+	if (eventLog != 0){
+		eventLog->record(logTrack, logMiss, it->second.timestamp, timestamp, reinterpret_cast<uint64>(it->second.request), blockAddr);
+	}
 
 	it->second.waitingForRead = false;
 	for (CallerList::iterator callerIt = it->second.callers.begin(); callerIt != it->second.callers.end(); callerIt++){
@@ -722,6 +850,10 @@ void Cache::process(const Event *event){
 	if (type == ACCESS){
 		RequestMap::iterator it = requests.find(blockAddr);
 		myassert(it != requests.end());
+		if (eventLog != 0 && it->second.waitingForTag){
+			uint32 logName = it->second.result == CacheModel::HIT ? logTagHit : logTagMiss;
+			eventLog->record(logTrack, logName, it->second.request->counters[tagCounterIndex], timestamp, reinterpret_cast<uint64>(it->second.request), blockAddr);
+		}
 		it->second.request->counters[tagCounterIndex] = timestamp - it->second.request->counters[tagCounterIndex];
 		it->second.waitingForTag = false;
 		if (it->second.result == CacheModel::HIT){
@@ -1292,3 +1424,12 @@ unsigned Cache::pin(addrint addr, IPinCallback *caller){
 	debug(": %lu, %s", addr, caller->getName());
 	return count;
 }
+
+void Cache::saveCheckpoint(CheckpointWriter *cp){
+	myassert(requests.empty());
+	cacheModel.saveCheckpoint(cp);
+}
+
+bool Cache::restoreCheckpoint(CheckpointReader *cp){
+	return cacheModel.restoreCheckpoint(cp);
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+#include "Checkpoint.H"
+
+#include <zlib.h>
+
+#include <cerrno>
+#include <map>
+
+static const char checkpointMagic[8] = {'H', 'M', 'M', 'S', 'I', 'M', 'C', 'P'};
+static const uint32 checkpointVersion = 1;
+
+void CheckpointWriter::writeString(const string& str){
+	write<uint64>(str.size());
+	buffer.append(str);
+}
+
+void CheckpointReader::readBytes(void *dest, size_t size){
+	if (pos + size > buffer.size()){
+		error("Checkpoint state of '%s' is truncated", name.c_str());
+	}
+	memcpy(dest, buffer.data() + pos, size);
+	pos += size;
+}
+
+void CheckpointReader::readString(string *str){
+	uint64 size = read<uint64>();
+	if (pos + size > buffer.size()){
+		error("Checkpoint state of '%s' is truncated", name.c_str());
+	}
+	str->assign(buffer, pos, size);
+	pos += size;
+}
+
+
+static void gzWriteBytes(gzFile file, const string& filename, const void *data, size_t size){
+	const char *ptr = static_cast<const char *>(data);
+	while (size > 0){
+		unsigned chunk = size > (1U << 30) ? (1U << 30) : size;
+		if (gzwrite(file, ptr, chunk) != static_cast<int>(chunk)){
+			error("Could not write to checkpoint file '%s'", filename.c_str());
+		}
+		ptr += chunk;
+		size -= chunk;
+	}
+}
+
+static void gzReadBytes(gzFile file, const string& filename, void *data, size_t size){
+	char *ptr = static_cast<char *>(data);
+	while (size > 0){
+		unsigned chunk = size > (1U << 30) ? (1U << 30) : size;
+		if (gzread(file, ptr, chunk) != static_cast<int>(chunk)){
+			error("Checkpoint file '%s' is truncated", filename.c_str());
+		}
+		ptr += chunk;
+		size -= chunk;
+	}
+}
+
+void Checkpointer::add(const string& name, ICheckpointable *component){
+	for (auto it = components.begin(); it != components.end(); ++it){
+		if (it->first == name){
+			error("Component '%s' is already part of the checkpoint", name.c_str());
+		}
+	}
+	components.emplace_back(name, component);
+}
+
+void Checkpointer::save(const string& filename){
+	gzFile file = gzopen(filename.c_str(), "wb");
+	if (file == 0){
+		error("Could not open checkpoint file '%s'", filename.c_str());
+	}
+	CheckpointWriter header;
+	header.write(checkpointMagic);
+	header.write(checkpointVersion);
+	header.write<uint32>(components.size());
+	gzWriteBytes(file, filename, header.getBuffer().data(), header.getBuffer().size());
+	for (auto it = components.begin(); it != components.end(); ++it){
+		CheckpointWriter cp;
+		it->second->saveCheckpoint(&cp);
+		CheckpointWriter section;
+		section.writeString(it->first);
+		section.write<uint64>(cp.getBuffer().size());
+		gzWriteBytes(file, filename, section.getBuffer().data(), section.getBuffer().size());
+		gzWriteBytes(file, filename, cp.getBuffer().data(), cp.getBuffer().size());
+	}
+	if (gzclose(file) != Z_OK){
+		error("Could not write to checkpoint file '%s'", filename.c_str());
+	}
+}
+
+void Checkpointer::restore(const string& filename){
+	gzFile file = gzopen(filename.c_str(), "rb");
+	if (file == 0){
+		error("Could not open checkpoint file '%s'", filename.c_str());
+	}
+	char magic[sizeof(checkpointMagic)];
+	uint32 version, numSections;
+	gzReadBytes(file, filename, magic, sizeof(magic));
+	if (memcmp(magic, checkpointMagic, sizeof(magic)) != 0){
+		error("'%s' is not a checkpoint file", filename.c_str());
+	}
+	gzReadBytes(file, filename, &version, sizeof(version));
+	if (version != checkpointVersion){
+		error("Checkpoint file '%s' has version %u (expected %u)", filename.c_str(), version, checkpointVersion);
+	}
+	gzReadBytes(file, filename, &numSections, sizeof(numSections));
+
+	map<string, string> sections;
+	for (uint32 i = 0; i < numSections; i++){
+		uint64 size;
+		gzReadBytes(file, filename, &size, sizeof(size));
+		string name(size, '\0');
+		gzReadBytes(file, filename, &name[0], size);
+		gzReadBytes(file, filename, &size, sizeof(size));
+		string &data = sections[name];
+		data.resize(size);
+		gzReadBytes(file, filename, &data[0], size);
+	}
+	gzclose(file);
+
+	for (auto it = components.begin(); it != components.end(); ++it){
+		auto sit = sections.find(it->first);
+		if (sit == sections.end()){
+			errno = 0;
+			warn("Checkpoint has no state for '%s'; it starts cold", it->first.c_str());
+			continue;
+		}
+		CheckpointReader cp(it->first, sit->second);
+		if (it->second->restoreCheckpoint(&cp)){
+			if (!cp.done()){
+				error("Checkpoint state of '%s' was not completely restored", it->first.c_str());
+			}
+		} else {
+			errno = 0;
+			warn("Checkpoint state of '%s' does not match its configuration; it starts cold", it->first.c_str());
+		}
+		sections.erase(sit);
+	}
+	for (auto sit = sections.begin(); sit != sections.end(); ++sit){
+		errno = 0;
+		warn("Checkpoint state of '%s' is not used", sit->first.c_str());
+	}
+}
@@ -7,6 +7,8 @@
 #include "Counter.H"
 #include "Error.H"
 
+#include <algorithm>
+#include <cstring>
 #include <iterator>
 
 Counter::Counter() : value(0), totalValue(0), handler(0), interruptValue(0) {
@@ -32,6 +34,22 @@ void Counter::setInterrupt(uint64 interruptValueArg, IInterruptHandler* handlerA
 	interruptValue = interruptValueArg;
 }
 
+void Counter::saveCheckpoint(CheckpointWriter *cp, uint64 excluded){
+	if (value >= excluded){
+		cp->write<uint64>(value - excluded);
+		cp->write(totalValue);
+	} else {
+		//the counter was reset after the excluded amount was added
+		cp->write<uint64>(0);
+		cp->write<uint64>(totalValue - (excluded - value));
+	}
+}
+
+void Counter::restoreCheckpoint(CheckpointReader *cp){
+	cp->read(&value);
+	cp->read(&totalValue);
+}
+
 
 CycleCounter::CycleCounter(Engine *engineArg) : engine(engineArg), lastCycleCount(0){
 
@@ -49,59 +67,173 @@ uint64 CycleCounter::getValue(){
 	return engine->getTimestamp() - lastCycleCount;
 }
 
-CounterTraceReader::CounterTraceReader(string fileName) {
-	ifstream file(fileName.c_str());
+#define COUNTER_TRACE_MAGIC "HMMCTRB1"
+
+CounterTraceReader::CounterTraceReader(string fileName) : stride(0) {
+	ifstream file(fileName.c_str(), ios::binary);
 	if(file.fail()){
 		error("Could not open counter trace file %s", fileName.c_str());
 	}
+	char magic[sizeof(COUNTER_TRACE_MAGIC) - 1];
+	file.read(magic, sizeof(magic));
+	if (file.gcount() == sizeof(magic) && memcmp(magic, COUNTER_TRACE_MAGIC, sizeof(magic)) == 0){
+		readBinary(file, fileName);
+	} else {
+		file.clear();
+		file.seekg(0);
+		readText(file, fileName);
+	}
+}
+
+void CounterTraceReader::readText(istream& file, const string& fileName){
+	map<uint64, map<unsigned, uint64> > rows;
 	string line;
 	while(getline(file, line)){
 		istringstream iss(line);
 		string line2;
-		map<uint64, map<string, uint64> >::iterator it;
+		map<uint64, map<unsigned, uint64> >::iterator it = rows.end();
 		while(getline(iss, line2, ',')) {
 			istringstream iss2(line2);
 			string key;
 			uint64 value;
 			iss2 >> key >> value;
 			if (key == "instructions"){
-				it = mapa.emplace(value, map<string, uint64>()).first;
+				it = rows.emplace(value, map<unsigned, uint64>()).first;
 			} else {
-				it->second.emplace(key, value);
+				if (it == rows.end()){
+					error("Counter trace file %s has a line that does not start with the number of instructions", fileName.c_str());
+				}
+				unordered_map<string, unsigned>::iterator kit = keyIds.emplace(key, keys.size()).first;
+				if (kit->second == keys.size()){
+					keys.emplace_back(key);
+				}
+				it->second.emplace(kit->second, value);
 			}
 		}
 	}
+
+	vector<vector<uint64> > columns(keys.size(), vector<uint64>(rows.size(), 0));
+	uint64 row = 0;
+	for (map<uint64, map<unsigned, uint64> >::iterator it = rows.begin(); it != rows.end(); ++it){
+		instructions.emplace_back(it->first);
+		for (map<unsigned, uint64>::iterator it2 = it->second.begin(); it2 != it->second.end(); ++it2){
+			columns[it2->first][row] = it2->second;
+		}
+		row++;
+	}
+	buildIndex(columns);
 }
 
-uint64 CounterTraceReader::getValue(uint64 instr, string key){
-	map<uint64, map<string, uint64> >::iterator it = mapa.find(instr);
-	if (it == mapa.end()){
-		return 0;
-	} else {
-		map<string, uint64>::iterator it2 = it->second.find(key);
-		if (it2 == it->second.end()){
+void CounterTraceReader::readBinary(istream& file, const string& fileName){
+	uint32 numKeys;
+	file.read(reinterpret_cast<char *>(&numKeys), sizeof(uint32));
+	for (uint32 i = 0; i < numKeys && file; i++){
+		uint32 length;
+		file.read(reinterpret_cast<char *>(&length), sizeof(uint32));
+		string key(length, ' ');
+		file.read(&key[0], length);
+		keyIds.emplace(key, keys.size());
+		keys.emplace_back(key);
+	}
+	uint64 numRows;
+	file.read(reinterpret_cast<char *>(&numRows), sizeof(uint64));
+	if (!file){
+		error("Error reading counter trace file %s", fileName.c_str());
+	}
+	instructions.resize(numRows);
+	file.read(reinterpret_cast<char *>(instructions.data()), numRows * sizeof(uint64));
+	vector<vector<uint64> > columns(keys.size(), vector<uint64>(numRows));
+	for (unsigned k = 0; k < keys.size(); k++){
+		file.read(reinterpret_cast<char *>(columns[k].data()), numRows * sizeof(uint64));
+	}
+	if (!file){
+		error("Error reading counter trace file %s", fileName.c_str());
+	}
+	buildIndex(columns);
+}
+
+void CounterTraceReader::buildIndex(const vector<vector<uint64> >& columns){
+	sums.assign(columns.size(), vector<uint64>(instructions.size() + 1, 0));
+	for (unsigned k = 0; k < columns.size(); k++){
+		for (uint64 i = 0; i < instructions.size(); i++){
+			sums[k][i + 1] = sums[k][i] + columns[k][i];
+		}
+	}
+	stride = instructions.size() > 1 ? instructions[1] - instructions[0] : 0;
+	for (uint64 i = 1; i < instructions.size() && stride != 0; i++){
+		if (instructions[i] - instructions[i - 1] != stride){
+			stride = 0;
+		}
+	}
+}
+
+uint64 CounterTraceReader::findRow(uint64 instr) const {
+	if (stride != 0){
+		if (instr <= instructions.front()){
 			return 0;
-		} else {
-			return it2->second;
 		}
+		return min<uint64>((instr - instructions.front() + stride - 1) / stride, instructions.size());
+	} else {
+		return lower_bound(instructions.begin(), instructions.end(), instr) - instructions.begin();
+	}
+}
+
+int CounterTraceReader::getKey(const string& key) const {
+	unordered_map<string, unsigned>::const_iterator it = keyIds.find(key);
+	return it == keyIds.end() ? -1 : it->second;
+}
+
+uint64 CounterTraceReader::getValue(uint64 instr, unsigned key) const {
+	uint64 row = findRow(instr);
+	if (row == instructions.size() || instructions[row] != instr){
+		return 0;
 	}
+	return sums[key][row + 1] - sums[key][row];
 }
 
-uint64 CounterTraceReader::getValue(uint64 instrStart, uint64 instrEnd, string key){
+uint64 CounterTraceReader::getValue(uint64 instrStart, uint64 instrEnd, unsigned key) const {
 	if (instrEnd < instrStart){
 		return 0;
 	}
-	uint64 value = 0;
-	map<uint64, map<string, uint64> >::iterator itStart = mapa.lower_bound(instrStart);
-	map<uint64, map<string, uint64> >::iterator itEnd = mapa.lower_bound(instrEnd);
-	while(itStart != itEnd){
-		map<string, uint64>::iterator it2 = itStart->second.find(key);
-		if (it2 != itStart->second.end()){
-			value += it2->second;
+	return sums[key][findRow(instrEnd)] - sums[key][findRow(instrStart)];
+}
+
+uint64 CounterTraceReader::getValue(uint64 instr, const string& key) const {
+	int id = getKey(key);
+	return id == -1 ? 0 : getValue(instr, static_cast<unsigned>(id));
+}
+
+uint64 CounterTraceReader::getValue(uint64 instrStart, uint64 instrEnd, const string& key) const {
+	int id = getKey(key);
+	return id == -1 ? 0 : getValue(instrStart, instrEnd, static_cast<unsigned>(id));
+}
+
+void CounterTraceReader::writeBinary(const string& fileName) const {
+	ofstream file(fileName.c_str(), ios::binary);
+	if(file.fail()){
+		error("Could not open counter trace file %s", fileName.c_str());
+	}
+	file.write(COUNTER_TRACE_MAGIC, sizeof(COUNTER_TRACE_MAGIC) - 1);
+	uint32 numKeys = keys.size();
+	file.write(reinterpret_cast<const char *>(&numKeys), sizeof(uint32));
+	for (unsigned k = 0; k < keys.size(); k++){
+		uint32 length = keys[k].size();
+		file.write(reinterpret_cast<const char *>(&length), sizeof(uint32));
+		file.write(keys[k].data(), length);
+	}
+	uint64 numRows = instructions.size();
+	file.write(reinterpret_cast<const char *>(&numRows), sizeof(uint64));
+	file.write(reinterpret_cast<const char *>(instructions.data()), numRows * sizeof(uint64));
+	vector<uint64> column(numRows);
+	for (unsigned k = 0; k < keys.size(); k++){
+		for (uint64 i = 0; i < numRows; i++){
+			column[i] = sums[k][i + 1] - sums[k][i];
 		}
-		++itStart;
+		file.write(reinterpret_cast<const char *>(column.data()), numRows * sizeof(uint64));
+	}
+	if (file.fail()){
+		error("Error writing counter trace file %s", fileName.c_str());
 	}
-	return value;
 }
 
 
@@ -112,12 +244,12 @@ void CounterTraceReader::print(ostream& os){
 	istream_iterator<string> end;
 	vector<string> order(itStr, end);
 
-	for(map<uint64, map<string, uint64> >::iterator it = mapa.begin(); it != mapa.end(); ++it){
-		os << "instructions " << it->first << ", ";
+	for(uint64 row = 0; row < instructions.size(); row++){
+		os << "instructions " << instructions[row] << ", ";
 		for (unsigned i = 0; i < order.size(); i++){
-			map<string, uint64>::iterator it2 = it->second.find(order[i]);
-			if (it2 != it->second.end()){
-				os << it2->first << " " << it2->second;
+			int key = getKey(order[i]);
+			if (key != -1){
+				os << order[i] << " " << sums[key][row + 1] - sums[key][row];
 				if (i == order.size() - 1){
 					os << endl;
 				} else {
@@ -129,8 +261,5 @@ void CounterTraceReader::print(ostream& os){
 }
 
 void CounterTraceReader::getKeyList(vector<uint64>* list){
-	list->clear();
-	for(map<uint64, map<string, uint64> >::iterator it = mapa.begin(); it != mapa.end(); ++it){
-		list->emplace_back(it->first);
-	}
+	*list = instructions;
 }
@@ -5,16 +5,25 @@
  */
 
 #include "Engine.H"
+#include "Error.H"
+#include "Profiler.H"
+#include "Telemetry.H"
 
 #include <cassert>
 
-Engine::Engine(StatContainer *statsArg, uint64 statsPeriodArg, const string& statsFilename, uint64 progressPeriodArg) :
+Engine::Engine(StatContainer *statsArg, uint64 statsPeriodArg, const string& statsFilename, const string& statsFormat, uint64 progressPeriodArg, TelemetryServer *telemetryArg, uint64 telemetryPeriodArg) :
 		stats(statsArg),
 		statsPeriod(statsPeriodArg),
 		progressPeriod(progressPeriodArg),
+		telemetry(telemetryArg),
+		telemetryPeriod(telemetryArg == 0 ? 0 : telemetryPeriodArg),
+		profiler(0),
+		eventLog(0),
 		currentInterval(0),
 		statsNextEvent(statsPeriodArg),
 		progressNextEvent(progressPeriodArg),
+		telemetryNextEvent(telemetryPeriod),
+		statsWriter(0),
 		done(false),
 		timestamp(0),
 		lastTimestamp(0),
@@ -31,38 +40,43 @@ Engine::Engine(StatContainer *statsArg, uint64 statsPeriodArg, const string& sta
 		statsPeriod = statsNextEvent = 0;
 	}
 
-	if (statsNextEvent == 0){
-		if (progressNextEvent == 0){
-
-		} else {
-			addEvent(progressNextEvent - timestamp, this);
-		}
-	} else {
-		statsOut.open(statsFilename.c_str());
-		if (!statsOut.is_open()){
-			error("Could not open statistics file '%s'", statsFilename.c_str());
-		}
-		statsOut.setf(std::ios::fixed);
-		statsOut.precision(2);
-		if (progressNextEvent == 0){
-			addEvent(statsNextEvent -timestamp, this);
-		} else {
-			if (statsNextEvent < progressNextEvent){
-				addEvent(statsNextEvent -timestamp, this);
-			} else {
-				addEvent(progressNextEvent - timestamp, this);
+	if (statsNextEvent != 0){
+		if (statsFormat == "text"){
+			statsOut.open(statsFilename.c_str());
+			if (!statsOut.is_open()){
+				error("Could not open statistics file '%s'", statsFilename.c_str());
 			}
+			statsOut.setf(std::ios::fixed);
+			statsOut.precision(2);
+		} else if (statsFormat == "binary"){
+			statsWriter = new IntervalStatsWriter(statsFilename, false);
+		} else if (statsFormat == "compressed"){
+			statsWriter = new IntervalStatsWriter(statsFilename, true);
+		} else {
+			error("Invalid interval statistics format: %s", statsFormat.c_str());
 		}
 	}
+	addUpdateEvent();
+}
 
-	gettimeofday(&start, NULL);
-	last = start;
+Engine::~Engine(){
+	delete statsWriter;
 }
 
 void Engine::run(){
+	//the execution time and event rate exclude the construction of the components
+	gettimeofday(&start, NULL);
+	last = start;
 	if (statsNextEvent != 0){
-		stats->printNames(statsOut);
-		statsOut << endl;
+		if (statsWriter == 0){
+			stats->printNames(statsOut);
+			statsOut << endl;
+		} else {
+			stats->writeNames(statsWriter);
+		}
+	}
+	if (profiler != 0){
+		profiler->start();
 	}
 	bool empty = currentEventsEmpty();
 	while (!done && !(empty && events.empty()) ){
@@ -98,7 +112,11 @@ void Engine::run(){
 		assert(timestamp == event.getTimestamp());
 
 		numEvents++;
-		event.execute();
+		if (profiler == 0){
+			event.execute();
+		} else {
+			profiler->execute(event);
+		}
 
 		empty = currentEventsEmpty();
 
@@ -108,9 +126,20 @@ void Engine::run(){
 //			}
 //		}
 	}
+	if (profiler != 0){
+		profiler->stop();
+	}
+	debug_flush();
 	updateStats();
+	if (telemetry != 0){
+		telemetry->publish(timestamp, numEvents, getPendingEvents(), true);
+	}
 	if (statsNextEvent != 0){
-		statsOut.close();
+		if (statsWriter == 0){
+			statsOut.close();
+		} else {
+			statsWriter->close();
+		}
 	}
 }
 
@@ -139,12 +168,24 @@ bool Engine::currentEventsEmpty(){
 	return true;
 }
 
+uint64 Engine::getPendingEvents(){
+	uint64 pending = events.size();
+	for (unsigned i = 0; i < currentSize; i++){
+		pending += currentEvents[i].size();
+	}
+	return pending;
+}
+
 void Engine::process(const Event * event){
 	if (timestamp == statsNextEvent){
 		updateStats();
 		statsNextEvent += statsPeriod;
-		stats->printInterval(statsOut);
-		statsOut << endl;
+		if (statsWriter == 0){
+			stats->printInterval(statsOut);
+			statsOut << endl;
+		} else {
+			stats->writeInterval(statsWriter);
+		}
 		currentInterval++;
 		stats->startInterval();
 	}
@@ -157,28 +198,35 @@ void Engine::process(const Event * event){
 		long useconds = current.tv_usec - last.tv_usec;
 		long mtime = seconds * 1000000 + useconds;
 		double eventsPerSecond = 1000000 * (static_cast<double>(eventsInPeriod) / static_cast<double>(mtime));
+		debug_flush();
 		cout << "Between timestamps " << lastTimestamp << " and " << timestamp << " executed " << eventsInPeriod << " events (" << eventsPerSecond << " events per second)" << endl;
 		lastTimestamp = timestamp;
 		lastNumEvents = numEvents;
 		last = current;
 	}
+	if (telemetryNextEvent != 0 && timestamp == telemetryNextEvent){
+		telemetryNextEvent += telemetryPeriod;
+		telemetry->publish(timestamp, numEvents, getPendingEvents(), false);
+	}
 	if (!currentEventsEmpty() || !events.empty()){
-		if (statsNextEvent == 0){
-			if (progressNextEvent != 0){
-				addEvent(progressNextEvent - timestamp, this);
-			}
-		} else {
-			if (progressNextEvent == 0){
-				addEvent(statsNextEvent -timestamp, this);
-			} else {
-				if (statsNextEvent < progressNextEvent){
-					addEvent(statsNextEvent -timestamp, this);
-				} else {
-					addEvent(progressNextEvent - timestamp, this);
-				}
-			}
+		addUpdateEvent();
+	}
+}
+
+/*
+ * Schedules the next statistics, progress or telemetry update, whichever comes first
+ */
+void Engine::addUpdateEvent(){
+	uint64 next = 0;
+	uint64 nextEvents[] = {statsNextEvent, progressNextEvent, telemetryNextEvent};
+	for (unsigned i = 0; i < sizeof(nextEvents) / sizeof(nextEvents[0]); i++){
+		if (nextEvents[i] != 0 && (next == 0 || nextEvents[i] < next)){
+			next = nextEvents[i];
 		}
 	}
+	if (next != 0){
+		addEvent(next - timestamp, this);
+	}
 }
 
 void Engine::updateStats(){
@@ -189,3 +237,70 @@ void Engine::updateStats(){
 	executionTime = static_cast<double>(seconds * 1000000 + useconds)/1000000;
 
 }
+
+void Engine::saveCheckpoint(CheckpointWriter *cp){
+	cp->write(timestamp);
+	cp->write(numEvents);
+	cp->write(currentInterval);
+	cp->write(statsNextEvent);
+	cp->write(progressNextEvent);
+}
+
+/*
+ * The events scheduled so far (by the components when they were created) are moved to the restored timestamp,
+ * and the statistics and progress updates continue where they left off
+ */
+bool Engine::restoreCheckpoint(CheckpointReader *cp){
+	if (timestamp != 0 || numEvents != 0){
+		error("The engine can only be restored before it starts running");
+	}
+	vector<Event> pending;
+	for (unsigned i = 0; i < currentSize; i++){
+		deque<Event>& current = currentEvents[(timestamp + i) % currentSize];
+		for (deque<Event>::iterator it = current.begin(); it != current.end(); ++it){
+			if (it->getHandler() != this){
+				pending.emplace_back(*it);
+			}
+		}
+		current.clear();
+	}
+	while (!events.empty()){
+		if (events.top().getHandler() != this){
+			pending.emplace_back(events.top());
+		}
+		events.pop();
+	}
+
+	uint64 oldTimestamp = timestamp;
+	uint64 savedStatsNextEvent, savedProgressNextEvent;
+	cp->read(&timestamp);
+	cp->read(&numEvents);
+	cp->read(&currentInterval);
+	cp->read(&savedStatsNextEvent);
+	cp->read(&savedProgressNextEvent);
+	lastTimestamp = timestamp;
+	lastNumEvents = numEvents;
+
+	for (vector<Event>::iterator it = pending.begin(); it != pending.end(); ++it){
+		addEvent(it->getTimestamp() - oldTimestamp, it->getHandler(), it->getData());
+	}
+
+	//the periods may differ from the ones the checkpoint was taken with
+	if (statsPeriod != 0){
+		statsNextEvent = savedStatsNextEvent == 0 ? timestamp + statsPeriod : savedStatsNextEvent;
+		while (statsNextEvent <= timestamp){
+			statsNextEvent += statsPeriod;
+		}
+	}
+	if (progressPeriod != 0){
+		progressNextEvent = savedProgressNextEvent == 0 ? timestamp + progressPeriod : savedProgressNextEvent;
+		while (progressNextEvent <= timestamp){
+			progressNextEvent += progressPeriod;
+		}
+	}
+	if (telemetryPeriod != 0){
+		telemetryNextEvent = timestamp + telemetryPeriod;
+	}
+	addUpdateEvent();
+	return true;
+}
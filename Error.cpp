@@ -6,6 +6,7 @@
 
 #include "Error.H"
 
+#include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cerrno>
@@ -14,12 +15,62 @@
 char msg_buffer[MAX_MSG_SIZE];
 uint64 debug2_timestamp = std::numeric_limits<uint64>::max();
 
+#define DEBUG_BUFFER_SIZE (64 * 1024)
+
+/*
+ * Debugging output of one thread, written to stdout in blocks instead of line by line
+ */
+struct DebugBuffer {
+	char data[DEBUG_BUFFER_SIZE];
+	size_t size;
+	DebugBuffer() : size(0) {}
+	~DebugBuffer() {flush();}
+	void flush(){
+		if (size != 0){
+			fwrite(data, 1, size, stdout);
+			fflush(stdout);
+			size = 0;
+		}
+	}
+};
+
+static thread_local DebugBuffer debug_buffer;
+
+void debug_print(const char *format, ...){
+	DebugBuffer& buffer = debug_buffer;
+	for (int attempt = 0; attempt < 2; attempt++){
+		size_t available = DEBUG_BUFFER_SIZE - buffer.size;
+		va_list args;
+		va_start(args, format);
+		int length = vsnprintf(buffer.data + buffer.size, available, format, args);
+		va_end(args);
+		if (length < 0){
+			return;
+		}
+		if (static_cast<size_t>(length) < available - 1){
+			buffer.size += length;
+			buffer.data[buffer.size++] = '\n';
+			return;
+		}
+		//the line does not fit: write what is buffered and try again with the whole buffer
+		buffer.flush();
+	}
+	//longer than the buffer, so it is truncated
+	buffer.size = DEBUG_BUFFER_SIZE - 1;
+	buffer.data[buffer.size++] = '\n';
+}
+
+void debug_flush(){
+	debug_buffer.flush();
+}
+
 
 void print_error(char *msg){
 	print_warn(msg);
 	exit(EXIT_FAILURE);
 }
 void print_warn(char *msg){
+	debug_flush();
 	if (errno == 0){
 		fputs(msg, stderr);
 		fputs("\n", stderr);
@@ -29,6 +80,7 @@ void print_warn(char *msg){
 }
 
 void print_assert(uint64 timestamp, const char *assertion, const char *file, unsigned line, const char *function){
+	debug_flush();
 	fprintf(stderr, "%lu: %s:%u: %s: Assertion '%s' failed.\n", timestamp, file, line, function, assertion);
 	abort();
 }
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+#include "EventLog.H"
+#include "Error.H"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#define EVENT_LOG_MAGIC "HMMEVTB1"
+
+EventLog::EventLog(const string& fileNameArg, uint64 startArg, uint64 endArg, uint64 bufferSize) :
+		fileName(fileNameArg),
+		file(fileNameArg.c_str(), ios::binary),
+		start(startArg),
+		end(endArg),
+		head(0),
+		tail(0),
+		done(false) {
+	if (!file.is_open()){
+		error("Could not open event log file '%s'", fileName.c_str());
+	}
+	if (bufferSize == 0 || (bufferSize & (bufferSize - 1)) != 0){
+		error("The size of the event log buffer must be a power of 2");
+	}
+	buffer.reset(new EventLogRecord[bufferSize]);
+	mask = bufferSize - 1;
+	file.write(EVENT_LOG_MAGIC, sizeof(EVENT_LOG_MAGIC) - 1);
+	writer = thread(&EventLog::drain, this);
+}
+
+EventLog::~EventLog(){
+	close();
+}
+
+uint32 EventLog::addTrack(const string& track){
+	tracks.emplace_back(track);
+	return tracks.size() - 1;
+}
+
+uint32 EventLog::addName(const string& name){
+	unordered_map<string, uint32>::iterator it = nameIds.emplace(name, names.size()).first;
+	if (it->second == names.size()){
+		names.emplace_back(name);
+	}
+	return it->second;
+}
+
+/*
+ * Runs in the writer thread. Writes every record between tail and head, in at most two pieces when they wrap around the
+ * end of the buffer, and sleeps when the buffer is empty.
+ */
+void EventLog::drain(){
+	while (true){
+		uint64 t = tail.load(memory_order_relaxed);
+		uint64 h = head.load(memory_order_acquire);
+		if (h == t){
+			if (done.load(memory_order_acquire)){
+				if (head.load(memory_order_acquire) == t){
+					break;
+				}
+				continue;
+			}
+			this_thread::sleep_for(chrono::milliseconds(1));
+			continue;
+		}
+		uint64 first = t & mask;
+		uint64 count = min(h - t, mask + 1 - first);
+		file.write(reinterpret_cast<const char *>(&buffer[first]), count * sizeof(EventLogRecord));
+		tail.store(t + count, memory_order_release);
+	}
+}
+
+void EventLog::wait(){
+	uint64 h = head.load(memory_order_relaxed);
+	while (h - tail.load(memory_order_acquire) > mask){
+		this_thread::yield();
+	}
+}
+
+void EventLog::close(){
+	if (!file.is_open()){
+		return;
+	}
+	done.store(true, memory_order_release);
+	writer.join();
+	uint64 numRecords = head.load(memory_order_relaxed);
+	uint64 namesOffset = file.tellp();
+	vector<string> *lists[] = {&tracks, &names};
+	for (unsigned i = 0; i < 2; i++){
+		uint32 size = lists[i]->size();
+		file.write(reinterpret_cast<const char *>(&size), sizeof(uint32));
+		for (vector<string>::const_iterator it = lists[i]->begin(); it != lists[i]->end(); ++it){
+			uint32 length = it->size();
+			file.write(reinterpret_cast<const char *>(&length), sizeof(uint32));
+			file.write(it->data(), length);
+		}
+	}
+	file.write(reinterpret_cast<const char *>(&numRecords), sizeof(uint64));
+	file.write(reinterpret_cast<const char *>(&namesOffset), sizeof(uint64));
+	file.close();
+	if (file.fail()){
+		error("Error writing event log file '%s'", fileName.c_str());
+	}
+}
+
+
+EventLogReader::EventLogReader(const string& fileNameArg) : fileName(fileNameArg), file(fileNameArg.c_str(), ios::binary), nextRecord(0) {
+	if (!file.is_open()){
+		error("Could not open event log file '%s'", fileName.c_str());
+	}
+	char magic[sizeof(EVENT_LOG_MAGIC) - 1];
+	file.read(magic, sizeof(magic));
+	if (!file || memcmp(magic, EVENT_LOG_MAGIC, sizeof(magic)) != 0){
+		error("File '%s' is not an event log", fileName.c_str());
+	}
+	uint64 trailer[2];
+	file.seekg(-static_cast<streamoff>(sizeof(trailer)), ios::end);
+	file.read(reinterpret_cast<char *>(trailer), sizeof(trailer));
+	if (!file){
+		error("Event log '%s' is truncated (the simulation did not finish)", fileName.c_str());
+	}
+	numRecords = trailer[0];
+	file.seekg(trailer[1]);
+	vector<string> *lists[] = {&tracks, &names};
+	for (unsigned i = 0; i < 2; i++){
+		uint32 size = 0;
+		file.read(reinterpret_cast<char *>(&size), sizeof(uint32));
+		for (uint32 j = 0; j < size && file; j++){
+			uint32 length;
+			file.read(reinterpret_cast<char *>(&length), sizeof(uint32));
+			string str(length, ' ');
+			file.read(&str[0], length);
+			lists[i]->emplace_back(str);
+		}
+	}
+	if (!file){
+		error("Error reading event log '%s'", fileName.c_str());
+	}
+	file.seekg(sizeof(magic));
+}
+
+bool EventLogReader::read(EventLogRecord *record){
+	if (nextRecord == numRecords){
+		return false;
+	}
+	file.read(reinterpret_cast<char *>(record), sizeof(EventLogRecord));
+	if (!file){
+		error("Error reading event log '%s'", fileName.c_str());
+	}
+	if (record->track >= tracks.size() || record->name >= names.size()){
+		error("Event log '%s' is corrupted", fileName.c_str());
+	}
+	nextRecord++;
+	return true;
+}
@@ -28,7 +28,11 @@ HybridMemory::HybridMemory(
 	unsigned completionThresholdArg,
 	bool elideCleanDramBlocksArg,
 	bool fixedPcmMigrationCostArg,
-	uint64 pcmMigrationCostArg) :
+	uint64 pcmMigrationCostArg,
+	unsigned sectorSizeArg,
+	unsigned maxCopyReadsArg,
+	unsigned maxCopyWritesArg,
+	IAccessMonitor *monitorArg) :
 		name(nameArg),
 		desc(descArg),
 		engine(engineArg),
@@ -48,7 +52,15 @@ HybridMemory::HybridMemory(
 		elideCleanDramBlocks(elideCleanDramBlocksArg),
 		fixedPcmMigrationCost(fixedPcmMigrationCostArg),
 		pcmMigrationCost(pcmMigrationCostArg),
+		sectorSize(sectorSizeArg == 0 ? pageSize : 1 << static_cast<unsigned>(logb(sectorSizeArg))),
+		blocksPerSector(sectorSize/blockSize),
+		sectorsPerPage(pageSize/sectorSize),
+		maxCopyReads(maxCopyReadsArg),
+		maxCopyWrites(maxCopyWritesArg),
 		pcmOffset(dramArg->getSize()),
+		copyReadsInFlight(0),
+		copyBufferedBlocks(0),
+		monitor(monitorArg),
 
 		dramReads(statCont, nameArg + "_dram_reads", "Number of DRAM reads seen by the " + descArg, 0),
 		dramWrites(statCont, nameArg + "_dram_writes", "Number of DRAM writes seen by the " + descArg, 0),
@@ -89,6 +101,11 @@ HybridMemory::HybridMemory(
 
 		totalAccessTime(statCont, nameArg + "_total_access_time", "Number of cycles servicing all accesses as seen by the " + descArg, &dramAccessTime, &pcmAccessTime),
 
+		dramReadTimeHistogram(statCont, nameArg + "_dram_read_latency", "Number of cycles servicing DRAM reads as seen by the " + descArg),
+		dramWriteTimeHistogram(statCont, nameArg + "_dram_write_latency", "Number of cycles servicing DRAM writes as seen by the " + descArg),
+		pcmReadTimeHistogram(statCont, nameArg + "_pcm_read_latency", "Number of cycles servicing PCM reads as seen by the " + descArg),
+		pcmWriteTimeHistogram(statCont, nameArg + "_pcm_write_latency", "Number of cycles servicing PCM writes as seen by the " + descArg),
+
 		avgDramReadTime(statCont, nameArg + "_avg_dram_read_time", "Average number of cycles servicing DRAM reads as seen by the " + descArg, &dramReadTime, &dramReads),
 		avgDramWriteTime(statCont, nameArg + "_avg_dram_write_time", "Average number of cycles servicing DRAM writes as seen by the " + descArg, &dramWriteTime, &dramWrites),
 		avgDramAccessTime(statCont, nameArg + "_avg_dram_access_time", "Average number of cycles servicing DRAM accesses as seen by the " + descArg, &dramAccessTime, &dramAccesses),
@@ -136,6 +153,12 @@ HybridMemory::HybridMemory(
 		dramPageCopyTime(statCont, nameArg + "_dram_page_copy_time", "Number of cycles copying DRAM pages by " + descArg, 0),
 		pcmPageCopyTime(statCont, nameArg + "_pcm_page_copy_time", "Number of cycles copying PCM pages by " + descArg, 0),
 
+		skippedCopyBlocks(statCont, nameArg + "_skipped_copy_blocks", "Number of blocks left in PCM during page copies by " + descArg, 0),
+		sectorFetchCount(statCont, nameArg + "_sector_fetches", "Number of sectors fetched on demand from PCM by " + descArg, 0),
+		sectorFetchTime(statCont, nameArg + "_sector_fetch_time", "Number of cycles fetching sectors on demand from PCM by " + descArg, 0),
+
+		copySlotWaits(statCont, nameArg + "_copy_slot_waits", "Number of times a page copy waited for a free slot in the copy engine of the " + descArg, 0),
+
 		dramReadsPerPid(statCont, numProcesses, nameArg + "_dram_reads_per_pid", "Number of DRAM reads seen by the " + descArg + " from process"),
 		dramWritesPerPid(statCont, numProcesses, nameArg + "_dram_writes_per_pid", "Number of DRAM writes seen by the " + descArg + " from process"),
 		dramAccessesPerPid(statCont, nameArg + "_dram_accesses_per_pid", "Number of DRAM accesses seen by the " + descArg + " from process", &dramReadsPerPid, &dramWritesPerPid),
@@ -180,7 +203,10 @@ HybridMemory::HybridMemory(
 
 		avgAccessTimePerPid(statCont, nameArg + "_avg_access_time_per_pid", "Average number of cycles servicing all accesses as seen by the " + descArg + " from process", &totalAccessTimePerPid, &totalAccessesPerPid)
 {
-
+	if (sectorSize > pageSize || sectorSize < blockSize){
+		error("Migration sector size (%u) must be between the block size (%u) and the page size (%u)", sectorSize, blockSize, pageSize);
+	}
+	monitor->setBlocksPerPage(blocksPerPage);
 }
 
 bool HybridMemory::access(MemoryRequest *request, IMemoryCallback *caller){
@@ -237,6 +263,7 @@ bool HybridMemory::access(MemoryRequest *request, IMemoryCallback *caller){
 			} else {
 				request->addr = manager->getAddressFromBlock(destPage, block);
 				mit->second.blocks[block].state = BUFFERED;
+				copyBufferedBlocks++;
 				mit->second.blocks[block].dirty = true;
 				mit->second.blocks[block].request = request;
 				mit->second.blocksLeftToRead--;
@@ -270,6 +297,7 @@ bool HybridMemory::access(MemoryRequest *request, IMemoryCallback *caller){
 				}
 			} else {
 				mit->second.blocks[block].state = BUFFERED;
+				copyBufferedBlocks++;
 				mit->second.blocks[block].dirty = true;
 				myassert(mit->second.blocks[block].request != 0);
 				mit->second.blocks[block].request = request;
@@ -317,11 +345,25 @@ bool HybridMemory::access(MemoryRequest *request, IMemoryCallback *caller){
 			} else {
 				return false;
 			}
+		} else if (mit->second.blocks[block].state == SKIPPED){
+			//block was not copied, so it is still in the PCM page
+			addrint pcmPage = mit->first < manager->getIndex(pcmOffset) ? mit->second.destPage : mit->first;
+			request->addr = manager->getAddressFromBlock(pcmPage, block);
+			if(accessNextLevel(request, caller, callbackAddr, false, 0)){
+				if (read){
+					readsFromPcm++;
+				} else {
+					writesToPcm++;
+				}
+			} else {
+				return false;
+			}
 		} else {
 			myassert(false);
 		}
 	} else {
 		addrint pcmPageOffset = manager->getIndex(pcmOffset);
+		addrint backingPage;
 		addrint destPage;
 		if(page >= pcmPageOffset && caller != manager && manager->migrateOnDemand(page, &destPage)){
 			myassert(destPage < pcmPageOffset);
@@ -332,6 +374,21 @@ bool HybridMemory::access(MemoryRequest *request, IMemoryCallback *caller){
 			pcmPageCopies++;
 			p.first->second.blocks.resize(blocksPerPage);
 
+			if (sectorSize < pageSize){
+				//only copy the sectors that have been accessed recently and the one being accessed now
+				vector<bool> copySectors(sectorsPerPage);
+				copySectors[block / blocksPerSector] = true;
+				const CountEntry *counts = monitor->getCounts(page);
+				if (counts != 0){
+					for (unsigned i = 0; i < blocksPerPage; i++){
+						if (counts->readBlocks[i] || counts->writtenBlocks[i]){
+							copySectors[i / blocksPerSector] = true;
+						}
+					}
+				}
+				skipSectors(&p.first->second, copySectors);
+			}
+
 			if (request->read){
 				if(accessNextLevel(request, caller, callbackAddr, true, page)){
 					p.first->second.blocks[block].state = READING;
@@ -344,6 +401,7 @@ bool HybridMemory::access(MemoryRequest *request, IMemoryCallback *caller){
 			} else {
 				request->addr = manager->getAddressFromBlock(p.first->second.destPage, block);
 				p.first->second.blocks[block].state = BUFFERED;
+				copyBufferedBlocks++;
 				p.first->second.blocks[block].dirty = true;
 				p.first->second.blocks[block].request = request;
 				p.first->second.blocksLeftToRead--;
@@ -361,6 +419,21 @@ bool HybridMemory::access(MemoryRequest *request, IMemoryCallback *caller){
 				myassert(p.first->second.nextReadBlock != static_cast<int>(block));
 				addEvent(0, READ, p.first->first);
 			}
+		} else if (type == DRAM && sectorSize < pageSize && manager->getSectorBacking(page, block / blocksPerSector, &backingPage)){
+			//sector of a partially migrated page that is still in PCM
+			request->addr = manager->getAddressFromBlock(backingPage, block);
+			if(accessNextLevel(request, caller, callbackAddr, false, 0)){
+				if (read){
+					readsFromPcm++;
+				} else {
+					writesToPcm++;
+				}
+				if (caller != manager){
+					fetchSector(page, block / blocksPerSector, backingPage);
+				}
+			} else {
+				return false;
+			}
 		} else {
 			if(accessNextLevel(request, caller, callbackAddr, false, 0)){
 				if (read){
@@ -383,19 +456,8 @@ bool HybridMemory::access(MemoryRequest *request, IMemoryCallback *caller){
 	}
 	if (caller != manager){
 		//ignore accesses that come from hybrid memory manager (these are due to flushes, which are not monitored)
-		auto monit = monitors.find(page);
-		if (monit == monitors.end()){
-			monit = monitors.emplace(page, CountEntry(page)).first;
-			monit->second.readBlocks.resize(blocksPerPage);
-			monit->second.writtenBlocks.resize(blocksPerPage);
-		}
-		if (read){
-			monit->second.reads++;
-			monit->second.readBlocks[block]++;
-		} else {
-			monit->second.writes++;
-			monit->second.writtenBlocks[block]++;
-		}
+		monitor->access(page, block, read);
+		manager->monitorPhysicalPage(page);
 	}
 	if(type == DRAM){
 		if (read){
@@ -425,6 +487,29 @@ bool HybridMemory::access(MemoryRequest *request, IMemoryCallback *caller){
 	return true;
 }
 
+/*
+ * Only the access monitor and the placement of pages are warmed up. Pages that the policy decides to migrate on demand are moved instantly
+ */
+void HybridMemory::functionalAccess(addrint addr, bool read, bool instr){
+	addrint page = manager->getIndex(addr);
+	addrint block = manager->getBlock(addr);
+	addrint destPage;
+	if (addr >= pcmOffset && manager->functionalMigrate(page, &destPage)){
+		monitor->movePage(page, destPage);
+		bool ins = dirties.emplace(destPage, vector<bool>(blocksPerPage)).second;
+		myassert(ins);
+		page = destPage;
+	}
+	if (!read){
+		auto dit = dirties.find(page);
+		if (dit != dirties.end()){
+			dit->second[block] = true;
+		}
+	}
+	monitor->access(page, block, read);
+	manager->monitorPhysicalPage(page);
+}
+
 bool HybridMemory::accessNextLevel(MemoryRequest *request, IMemoryCallback *caller, addrint callbackAddr, bool partOfMigration, addrint srcPage){
 	uint64 timestamp = engine->getTimestamp();
 	if (request->addr < pcmOffset){
@@ -461,6 +546,10 @@ bool HybridMemory::accessNextLevel(MemoryRequest *request, IMemoryCallback *call
 void HybridMemory::accessCompleted(MemoryRequest *request, IMemory *caller){
 	uint64 timestamp = engine->getTimestamp();
 	debug("(%p, %lu, %s, %s)", request, request->addr, request->read ? "read" : "write", caller->getName());
+	if (!sectorFetchRequests.empty() && sectorFetchRequests.count(request) != 0){
+		sectorReadCompleted(request);
+		return;
+	}
 	bool partOfMigration = true;
 	addrint block = manager->getBlock(request->addr);
 	addrint page = manager->getIndex(request->addr);
@@ -472,11 +561,13 @@ void HybridMemory::accessCompleted(MemoryRequest *request, IMemory *caller){
 		if (caller == dram){
 			if (request->read){
 				dramReadTime += accessTime;
+				dramReadTimeHistogram.record(accessTime);
 				if (pid >= 0){
 					dramReadTimePerPid[pid] += accessTime;
 				}
 			} else {
 				dramWriteTime += accessTime;
+				dramWriteTimeHistogram.record(accessTime);
 				if (pid >= 0){
 					dramWriteTimePerPid[pid] += accessTime;
 				}
@@ -484,11 +575,13 @@ void HybridMemory::accessCompleted(MemoryRequest *request, IMemory *caller){
 		} else if (caller == pcm){
 			if (request->read){
 				pcmReadTime += accessTime;
+				pcmReadTimeHistogram.record(accessTime);
 				if (pid >= 0){
 					pcmReadTimePerPid[pid] += accessTime;
 				}
 			} else {
 				pcmWriteTime += accessTime;
+				pcmWriteTimeHistogram.record(accessTime);
 				if (pid >= 0){
 					pcmWriteTimePerPid[pid] += accessTime;
 				}
@@ -520,6 +613,7 @@ void HybridMemory::accessCompleted(MemoryRequest *request, IMemory *caller){
 		} else if(mit->second.blocks[block].state == READING){
 			myassert(caller == mit->second.src);
 			mit->second.blocks[block].state = BUFFERED;
+			copyBufferedBlocks++;
 			if (calledBack){
 				mit->second.blocks[block].request = 0;
 			}
@@ -569,6 +663,11 @@ void HybridMemory::accessCompleted(MemoryRequest *request, IMemory *caller){
 		} else {
 			myassert(false);
 		}
+		if (!calledBack){
+			//read was issued by the copy engine
+			copyReadsInFlight--;
+			wakeCopySlotWaiter();
+		}
 		mit->second.blockLeftToCompleteRead--;
 		if (mit->second.blockLeftToCompleteRead == 0 && mit->second.blocksLeftToWrite == 0){
 			debug(": finish copy, src: %s, dest: %s", mit->second.src->getName(), mit->second.dest->getName());
@@ -621,7 +720,25 @@ void HybridMemory::copyPage(addrint srcPage, addrint destPage){
 					}
 					dirties.erase(dit);
 				}
-				addEvent(0, READ, srcPage);
+				const vector<bool> *validSectors = manager->getValidSectors(srcPage);
+				if (validSectors != 0){
+					//sectors that were never fetched are already in the destination (backing) page
+					skipSectors(&p.first->second, *validSectors);
+				}
+				if (p.first->second.blocksLeftToRead == 0 && p.first->second.blocksLeftToWrite == 0){
+					addEvent(1, COPY, srcPage);
+				} else {
+					addEvent(0, READ, srcPage);
+				}
+			}
+			if (sectorSize < pageSize){
+				//sectors being fetched into the page are not needed anymore
+				for (unsigned i = 0; i < sectorsPerPage; i++){
+					auto fit = sectorFetches.find(manager->getAddressFromBlock(srcPage, i * blocksPerSector));
+					if (fit != sectorFetches.end()){
+						fit->second.cancelled = true;
+					}
+				}
 			}
 
 			pcmPageCopies++;
@@ -657,13 +774,7 @@ void HybridMemory::finishMigration(addrint page){
 				dit.first->second[i] = mit->second.blocks[i].dirty;
 			}
 		}
-		auto monit = monitors.find(page);
-		if (monit != monitors.end()){
-			monit->second.page = mit->second.destPage;
-			bool ins = monitors.emplace(mit->second.destPage, monit->second).second;
-			myassert(ins);
-			monitors.erase(monit);
-		}
+		monitor->movePage(page, mit->second.destPage);
 	}
 	migrations.erase(mit);
 }
@@ -691,7 +802,8 @@ void HybridMemory::rollback(addrint srcPage){
 		} else if (bit->state == READING){
 			bit->state = WRITTEN;
 			bit->request = 0;
-			//must ignore read when it comes back (don't send to DRAM)
+			mit->second.blockLeftToCompleteRead++;
+			//must ignore read when it comes back (don't send to DRAM), but wait for it before completing
 		} else if (bit->state == BUFFERED){
 			if (bit->dirty){
 				bit->state = BUFFERED;
@@ -700,6 +812,7 @@ void HybridMemory::rollback(addrint srcPage){
 				//must schedule write to src (PCM)
 			} else {
 				bit->state = WRITTEN;
+				copyBufferedBlocks--;
 			}
 		} else if (bit->state == WRITTEN){
 			if (bit->dirty){
@@ -712,12 +825,14 @@ void HybridMemory::rollback(addrint srcPage){
 			} else {
 				bit->state = WRITTEN;
 			}
+		} else if (bit->state == SKIPPED){
+			//block never left PCM
 		} else {
 			myassert(false);
 		}
 	}
 	debug(": blocksLeftToRead: %u, blocksLeftToWrite: %u", mit->second.blocksLeftToRead, mit->second.blocksLeftToWrite);
-	if (mit->second.blocksLeftToRead == 0 && mit->second.blocksLeftToWrite == 0){
+	if (mit->second.blocksLeftToRead == 0 && mit->second.blockLeftToCompleteRead == 0 && mit->second.blocksLeftToWrite == 0){
 		addEvent(1, COPY, mit->first);
 	} else {
 		if (mit->second.blocksLeftToRead > 0){
@@ -767,7 +882,9 @@ void HybridMemory::process(const Event *event){
 	} else if (data->type == READ){
 		auto mit = migrations.find(data->page);
 		myassert(mit != migrations.end());
-		if (mit->second.blocksLeftToRead > 0){
+		if (mit->second.blocksLeftToRead > 0 && !isCopySlotFree()){
+			waitForCopySlot(mit->first);
+		} else if (mit->second.blocksLeftToRead > 0){
 			auto it = mit->second.blocks.begin();
 			it += mit->second.nextReadBlock;
 			myassert(it != mit->second.blocks.end());
@@ -795,6 +912,7 @@ void HybridMemory::process(const Event *event){
 				debug(": %s.access(%p, %lu, %u, %s, %s, %d)", mit->second.src->getName(), it->request, it->request->addr, it->request->size, it->request->read?"read":"write", it->request->instr?"instr":"data", it->request->priority);
 				if (stalledOnRead.empty() && mit->second.src->access(it->request, this)){
 					it->state = READING;
+					copyReadsInFlight++;
 					it->startTime = timestamp;
 					mit->second.blocksLeftToRead--;
 					auto bit = mit->second.blocks.begin();
@@ -807,6 +925,7 @@ void HybridMemory::process(const Event *event){
 						mit->second.nextReadBlock = block;
 						addEvent(mit->second.readDelay, READ, data->page);
 					}
+					wakeCopySlotWaiter();
 				} else{
 					if (created){
 						delete(it->request);
@@ -856,6 +975,8 @@ void HybridMemory::process(const Event *event){
 					myassert(false);
 				}
 				it->state = WRITTEN;
+				copyBufferedBlocks--;
+				wakeCopySlotWaiter();
 				it->startTime = timestamp;
 				mit->second.lastWrite = timestamp;
 
@@ -902,6 +1023,14 @@ void HybridMemory::process(const Event *event){
 			it->callback->accessCompleted(it->request, this);
 		}
 		notifications.clear();
+	} else if (data->type == SECTOR_READ){
+		while (!stalledSectorReads.empty() && pcm->access(stalledSectorReads.front(), this)){
+			stalledSectorReads.pop_front();
+		}
+	} else if (data->type == SECTOR_WRITE){
+		while (!stalledSectorWrites.empty() && issueSectorWrite(stalledSectorWrites.front())){
+			stalledSectorWrites.pop_front();
+		}
 	} else {
 		myassert(false);
 	}
@@ -947,18 +1076,149 @@ void HybridMemory::unstall(IMemory *caller){
 		}
 	}
 	stalledOnWrite.clear();
-}
 
-void HybridMemory::readCountsAndProgress(vector<CountEntry> *monitor, vector<ProgressEntry> *progress){
-	for (auto monit = monitors.begin(); monit != monitors.end(); ++monit){
-		monitor->emplace_back(monit->second);
+	//the memory calls unstall before it frees the queue slot, so the stalled sector requests are retried later too
+	if (caller == pcm){
+		if (!stalledSectorReads.empty()){
+			addEvent(2, SECTOR_READ);
+		}
+	} else {
+		if (!stalledSectorWrites.empty()){
+			addEvent(2, SECTOR_WRITE);
+		}
 	}
-	monitors.clear();
+}
+
+void HybridMemory::readCountsAndProgress(vector<CountEntry> *counts, vector<ProgressEntry> *progress){
+	monitor->readCounts(counts);
 	for (auto it = migrations.begin(); it != migrations.end(); ++it){
 		progress->emplace_back(it->first, it->second.blocksLeftToWrite, it->second.startPageCopyTime);
 	}
 }
 
+bool HybridMemory::getCopiedSectors(addrint srcPage, vector<bool> *validSectors){
+	if (sectorSize == pageSize){
+		return false;
+	}
+	auto mit = migrations.find(srcPage);
+	myassert(mit != migrations.end());
+	bool partial = false;
+	validSectors->assign(sectorsPerPage, true);
+	for (unsigned i = 0; i < blocksPerPage; i++){
+		if (mit->second.blocks[i].state == SKIPPED){
+			(*validSectors)[i / blocksPerSector] = false;
+			partial = true;
+		}
+	}
+	if (!partial){
+		validSectors->clear();
+	}
+	return partial;
+}
+
+bool HybridMemory::isCopySlotFree() const {
+	return (maxCopyReads == 0 || copyReadsInFlight < maxCopyReads) && (maxCopyWrites == 0 || copyReadsInFlight + copyBufferedBlocks < maxCopyWrites);
+}
+
+void HybridMemory::waitForCopySlot(addrint page){
+	auto mit = migrations.find(page);
+	myassert(mit != migrations.end());
+	//serve the oldest copies first so that the blocks of a page are read back to back
+	auto wit = waitingOnCopySlot.begin();
+	while (wit != waitingOnCopySlot.end()){
+		if (*wit == page){
+			return;
+		}
+		auto wmit = migrations.find(*wit);
+		if (wmit != migrations.end() && wmit->second.startPageCopyTime > mit->second.startPageCopyTime){
+			break;
+		}
+		++wit;
+	}
+	waitingOnCopySlot.insert(wit, page);
+	copySlotWaits++;
+}
+
+void HybridMemory::wakeCopySlotWaiter(){
+	while (!waitingOnCopySlot.empty() && isCopySlotFree()){
+		addrint page = waitingOnCopySlot.front();
+		waitingOnCopySlot.pop_front();
+		if (migrations.count(page) != 0){
+			addEvent(0, READ, page);
+			return;
+		}
+	}
+}
+
+void HybridMemory::skipSectors(MigrationEntry *entry, const vector<bool>& copySectors){
+	for (unsigned i = 0; i < blocksPerPage; i++){
+		if (!copySectors[i / blocksPerSector] && entry->blocks[i].state == NOT_READ){
+			entry->blocks[i].state = SKIPPED;
+			entry->blocksLeftToRead--;
+			entry->blockLeftToCompleteRead--;
+			entry->blocksLeftToWrite--;
+			skippedCopyBlocks++;
+		}
+	}
+}
+
+void HybridMemory::fetchSector(addrint page, unsigned sector, addrint backingPage){
+	uint64 timestamp = engine->getTimestamp();
+	addrint firstBlock = sector * blocksPerSector;
+	auto p = sectorFetches.emplace(manager->getAddressFromBlock(page, firstBlock), SectorFetchEntry(page, backingPage, blocksPerSector, timestamp));
+	if (!p.second){
+		//sector is already being fetched
+		return;
+	}
+	debug("(%lu, %u, %lu)", page, sector, backingPage);
+	sectorFetchCount++;
+	for (addrint block = firstBlock; block < firstBlock + blocksPerSector; block++){
+		MemoryRequest *request = new MemoryRequest(manager->getAddressFromBlock(backingPage, block), blockSize, true, false, LOW);
+		sectorFetchRequests.emplace(request, p.first->first);
+		if (!stalledSectorReads.empty() || !pcm->access(request, this)){
+			stalledSectorReads.emplace_back(request);
+		}
+	}
+}
+
+void HybridMemory::sectorReadCompleted(MemoryRequest *request){
+	auto rit = sectorFetchRequests.find(request);
+	myassert(rit != sectorFetchRequests.end());
+	auto fit = sectorFetches.find(rit->second);
+	myassert(fit != sectorFetches.end());
+	pcmCopyReads++;
+	request->addr = manager->getAddressFromBlock(fit->second.page, manager->getBlock(request->addr));
+	request->read = false;
+	if (!stalledSectorWrites.empty() || !issueSectorWrite(request)){
+		stalledSectorWrites.emplace_back(request);
+	}
+}
+
+bool HybridMemory::issueSectorWrite(MemoryRequest *request){
+	uint64 timestamp = engine->getTimestamp();
+	auto rit = sectorFetchRequests.find(request);
+	myassert(rit != sectorFetchRequests.end());
+	auto fit = sectorFetches.find(rit->second);
+	myassert(fit != sectorFetches.end());
+	if (fit->second.cancelled){
+		delete request;
+	} else if (dram->access(request, this)){
+		dramCopyWrites++;
+	} else {
+		return false;
+	}
+	sectorFetchRequests.erase(rit);
+	fit->second.blocksLeft--;
+	if (fit->second.blocksLeft == 0){
+		if (!fit->second.cancelled){
+			sectorFetchTime += timestamp - fit->second.startTime;
+			manager->sectorFetched(fit->second.page, manager->getBlock(fit->first) / blocksPerSector);
+		}
+		sectorFetches.erase(fit);
+	}
+	return true;
+}
+
 void HybridMemory::setManager(HybridMemoryManager *managerArg) {
 	manager = managerArg;
 }
@@ -1048,6 +1308,11 @@ OldHybridMemory::OldHybridMemory(
 
 		totalAccessTime(statCont, nameArg + "_total_access_time", "Number of cycles servicing all accesses as seen by the " + descArg, &dramAccessTime, &pcmAccessTime),
 
+		dramReadTimeHistogram(statCont, nameArg + "_dram_read_latency", "Number of cycles servicing DRAM reads as seen by the " + descArg),
+		dramWriteTimeHistogram(statCont, nameArg + "_dram_write_latency", "Number of cycles servicing DRAM writes as seen by the " + descArg),
+		pcmReadTimeHistogram(statCont, nameArg + "_pcm_read_latency", "Number of cycles servicing PCM reads as seen by the " + descArg),
+		pcmWriteTimeHistogram(statCont, nameArg + "_pcm_write_latency", "Number of cycles servicing PCM writes as seen by the " + descArg),
+
 		avgDramReadTime(statCont, nameArg + "_avg_dram_read_time", "Average number of cycles servicing DRAM reads as seen by the " + descArg, &dramReadTime, &dramReads),
 		avgDramWriteTime(statCont, nameArg + "_avg_dram_write_time", "Average number of cycles servicing DRAM writes as seen by the " + descArg, &dramWriteTime, &dramWrites),
 		avgDramAccessTime(statCont, nameArg + "_avg_dram_access_time", "Average number of cycles servicing DRAM accesses as seen by the " + descArg, &dramAccessTime, &dramAccesses),
@@ -1325,12 +1590,14 @@ void OldHybridMemory::accessCompleted(MemoryRequest *request, IMemory *caller){
 		if (caller == dram){
 			if (request->read){
 				dramReadTime += accessTime;
+				dramReadTimeHistogram.record(accessTime);
 				if (pid >= 0){
 					dramReadTimePerPid[pid] += accessTime;
 					dramReadTimeCounters[pid] += accessTime;
 				}
 			} else {
 				dramWriteTime += accessTime;
+				dramWriteTimeHistogram.record(accessTime);
 				if (pid >= 0){
 					dramWriteTimePerPid[pid] += accessTime;
 					dramWriteTimeCounters[pid] += accessTime;
@@ -1339,12 +1606,14 @@ void OldHybridMemory::accessCompleted(MemoryRequest *request, IMemory *caller){
 		} else if (caller == pcm){
 			if (request->read){
 				pcmReadTime += accessTime;
+				pcmReadTimeHistogram.record(accessTime);
 				if (pid >= 0){
 					pcmReadTimePerPid[pid] += accessTime;
 					pcmReadTimeCounters[pid] += accessTime;
 				}
 			} else {
 				pcmWriteTime += accessTime;
+				pcmWriteTimeHistogram.record(accessTime);
 				if (pid >= 0){
 					pcmWriteTimePerPid[pid] += accessTime;
 					pcmWriteTimeCounters[pid] += accessTime;
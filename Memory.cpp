@@ -82,6 +82,9 @@ Memory::Memory(
 		waitLowerPriorityTime(statCont, nameArg + "_wait_lower_priority_time", "Number of cycles " + descArg + " requests wait for lower priority requests", 0),
 		waitSamePriorityTime(statCont, nameArg + "_wait_same_priority_time", "Number of cycles " + descArg + " requests wait for same priority requests", 0),
 		waitHigherPriorityTime(statCont, nameArg + "_wait_higher_priority_time", "Number of cycles " + descArg + " requests wait for higher priority requests", 0),
+		readTimeHistogram(statCont, nameArg + "_read_latency", "Number of cycles of " + descArg + " read requests"),
+		writeTimeHistogram(statCont, nameArg + "_write_latency", "Number of cycles of " + descArg + " write requests"),
+		queueSize(statCont, nameArg + "_queue_size", "Number of requests in the queues of " + descArg, this, &Memory::getQueueSize),
 		numRequests(statCont, nameArg + "_requests", "Total number of " + descArg + " requests", &numReadRequests, &numWriteRequests),
 		averageQueueStallTime(statCont, nameArg + "_avg_queue_stall_time", "Average number of cycles " + descArg + " queue is stalled", &queueStallTime, &numRequests),
 		totalStallTime(statCont, nameArg + "_total_stall_time", "Total number of cycles " + descArg + " stalls on requests", &readStallTime, &writeStallTime),
@@ -158,6 +161,15 @@ Memory::~Memory(){
 	delete [] queueSizes;
 }
 
+uint64 Memory::getQueueSize(){
+	uint64 size = 0;
+	unsigned numQueues = globalQueue ? 1 : mapping.getNumBanks();
+	for (unsigned i = 0; i < numQueues; i++){
+		size += queueSizes[i];
+	}
+	return size;
+}
+
 bool Memory::access(MemoryRequest *request, IMemoryCallback *caller){
 	uint64 timestamp = engine->getTimestamp();
 	debug("(%p, %lu, %u, %s, %s, %d, %s)", request, request->addr, request->size, request->read?"read":"write", request->instr?"instr":"data", request->priority, caller->getName());
@@ -238,6 +250,24 @@ void Memory::accessCompleted(MemoryRequest *request, IMemory *caller) {
 	queueSizes[queueIndex]--;
 }
 
+void Memory::saveCheckpoint(CheckpointWriter *cp){
+	myassert(requests.empty());
+	cp->write<uint64>(banks.size());
+	for (unsigned i = 0; i < banks.size(); i++){
+		banks[i]->saveCheckpoint(cp);
+	}
+}
+
+bool Memory::restoreCheckpoint(CheckpointReader *cp){
+	if (cp->read<uint64>() != banks.size()){
+		return false;
+	}
+	for (unsigned i = 0; i < banks.size(); i++){
+		banks[i]->restoreCheckpoint(cp);
+	}
+	return true;
+}
+
 
 CacheMemory::CacheMemory(
 		const string& nameArg,
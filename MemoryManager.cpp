@@ -45,6 +45,7 @@ HybridMemoryManager::HybridMemoryManager(
 		memory(memoryArg),
 		policies(policiesArg),
 		partition(partitionArg),
+		monitorPartition(partitionArg->needsMonitoring()),
 		flushPolicy(flushPolicyArg),
 		maxFlushQueueSize(maxFlushQueueSizeArg),
 		suppressFlushWritebacks(suppressFlushWritebacksArg),
@@ -54,6 +55,14 @@ HybridMemoryManager::HybridMemoryManager(
 		maxMigrationTableSize(maxMigrationTableSizeArg),
 		perPageStats(perPageStatsArg),
 		perPageStatsFilename(perPageStatsFilenameArg),
+		eventLog(engineArg->getEventLog()),
+		logTrack(0),
+		logFlushBefore(0),
+		logCopy(0),
+		logFlushAfter(0),
+		logPromotion(0),
+		logDemotion(0),
+		logRollback(0),
 
 		dramFullMigrations(statCont, "manager_dram_full_migrations", "Number of full DRAM migrations", 0),
 		dramPartialMigrations(statCont, "manager_dram_partial_migrations", "Number of partial DRAM migrations (rolledback)", 0),
@@ -71,6 +80,9 @@ HybridMemoryManager::HybridMemoryManager(
 		migrationEntriesCount(statCont, "manager_migration_entries_count", "Number of migrations started", 0),
 		avgMigrationEntries(statCont, "manager_avg_migration_entries", "Average number of ongoing migrations", &migrationEntriesSum, &migrationEntriesCount),
 
+		sectoredPromotions(statCont, "manager_sectored_promotions", "Number of migrations to DRAM that left cold sectors in PCM", 0),
+		backingPagesReleased(statCont, "manager_backing_pages_released", "Number of PCM backing pages released after all their sectors were fetched", 0),
+
 		cleanFlushedBlocks(statCont, "manager_clean_flushed_blocks", "Number of clean flushed blocks", 0),
 		dirtyFlushedBlocks(statCont, "manager_dirty_flushed_blocks", "Number of dirty flushed blocks", 0),
 		tagChanges(statCont, "manager_tag_changes", "Number of tag changes", 0),
@@ -145,6 +157,16 @@ HybridMemoryManager::HybridMemoryManager(
 {
 	memory->setManager(this);
 
+	if (eventLog != 0){
+		logTrack = eventLog->addTrack(name);
+		logFlushBefore = eventLog->addName("flush before");
+		logCopy = eventLog->addName("copy");
+		logFlushAfter = eventLog->addName("flush after");
+		logPromotion = eventLog->addName("promotion");
+		logDemotion = eventLog->addName("demotion");
+		logRollback = eventLog->addName("rollback");
+	}
+
 	unsigned logBlockSize = static_cast<unsigned>(logb(blockSizeArg));
 	blockSize = 1 << logBlockSize;
 
@@ -201,6 +223,8 @@ HybridMemoryManager::HybridMemoryManager(
 		policies[i]->setNumDramPages(partition->getDramPages(i));
 	}
 
+	sectoredPages = 0;
+
 	idle = true;
 	lastStartIdleTime = 0;
 
@@ -233,26 +257,7 @@ bool HybridMemoryManager::access(int pid, addrint virtualAddr, bool read, bool i
 	addrint virtualPage = getIndex(virtualAddr);
 	PageMap::iterator it = pages[pid].find(virtualPage);
 	if (it == pages[pid].end()){
-		PageType type = policies[pid]->allocate(pid, virtualPage, read, instr);
-		addrint freePage;
-		if (type == DRAM){
-			myassert(!dramFreePageList.empty());
-			freePage = dramFreePageList.front();
-			dramFreePageList.pop_front();
-			dramMemorySizeUsedPerPid[pid] += pageSize;
-		} else if (type == PCM){
-			if (pcmFreePageList.empty()){
-				error("PCM free page list is empty");
-			}
-			freePage = pcmFreePageList.front();
-			pcmFreePageList.pop_front();
-			pcmMemorySizeUsedPerPid[pid] += pageSize;
-		} else {
-			myassert(false);
-		}
-		it = pages[pid].emplace(virtualPage, PageEntry(freePage, type, timestamp)).first;
-		bool ins = physicalPages.emplace(it->second.page, PhysicalPageEntry(pid, virtualPage)).second;
-		myassert(ins);
+		it = allocatePage(pid, virtualPage, read, instr);
 	}
 	myassert((isDramPage(it->second.page) && it->second.type == DRAM) || (isPcmPage(it->second.page) && it->second.type == PCM));
 
@@ -266,6 +271,43 @@ bool HybridMemoryManager::access(int pid, addrint virtualAddr, bool read, bool i
 	}
 }
 
+/*
+ * Must only be called before the simulation starts, when there are no migrations in progress
+ */
+addrint HybridMemoryManager::functionalAccess(int pid, addrint virtualAddr, bool read, bool instr){
+	addrint virtualPage = getIndex(virtualAddr);
+	PageMap::iterator it = pages[pid].find(virtualPage);
+	if (it == pages[pid].end()){
+		it = allocatePage(pid, virtualPage, read, instr);
+	}
+	//when sampling, the page can be in the middle of a migration started by the detailed simulation; its current location is used
+	return getAddress(it->second.page, getOffset(virtualAddr));
+}
+
+HybridMemoryManager::PageMap::iterator HybridMemoryManager::allocatePage(int pid, addrint virtualPage, bool read, bool instr){
+	uint64 timestamp = engine->getTimestamp();
+	PageType type = policies[pid]->allocate(pid, virtualPage, read, instr);
+	addrint freePage;
+	if (type == DRAM){
+		myassert(!dramFreePageList.empty());
+		freePage = dramFreePageList.front();
+		dramFreePageList.pop_front();
+		dramMemorySizeUsedPerPid[pid] += pageSize;
+	} else {
+		myassert(type == PCM);
+		if (pcmFreePageList.empty()){
+			error("PCM free page list is empty");
+		}
+		freePage = pcmFreePageList.front();
+		pcmFreePageList.pop_front();
+		pcmMemorySizeUsedPerPid[pid] += pageSize;
+	}
+	PageMap::iterator it = pages[pid].emplace(virtualPage, PageEntry(freePage, type, timestamp)).first;
+	bool ins = physicalPages.emplace(it->second.page, PhysicalPageEntry(pid, virtualPage)).second;
+	myassert(ins);
+	return it;
+}
+
 bool HybridMemoryManager::migrateOnDemand(addrint physicalPage, addrint *destPhysicalPage){
 	uint64 timestamp = engine->getTimestamp();
 	debug("(%lu)", physicalPage);
@@ -310,6 +352,52 @@ bool HybridMemoryManager::migrateOnDemand(addrint physicalPage, addrint *destPhy
 	}
 }
 
+/*
+ * Same as migrateOnDemand, but the page is moved to DRAM instantly
+ */
+bool HybridMemoryManager::functionalMigrate(addrint physicalPage, addrint *destPhysicalPage){
+	if (dramFreePageList.empty()){
+		return false;
+	}
+
+	auto pit = physicalPages.find(physicalPage);
+	myassert(pit != physicalPages.end());
+	int pid = pit->second.pid;
+	addrint virtualPage = pit->second.virtualPage;
+	auto it = pages[pid].find(virtualPage);
+	myassert(it != pages[pid].end());
+	myassert(it->second.type == PCM);
+	if (it->second.isMigrating){
+		return false;
+	}
+
+	if (!policies[pid]->migrate(pid, virtualPage)){
+		return false;
+	}
+
+	*destPhysicalPage = dramFreePageList.front();
+	dramFreePageList.pop_front();
+	dramMemorySizeUsedPerPid[pid] += pageSize;
+	pcmFreePageList.emplace_back(physicalPage);
+	pcmMemorySizeUsedPerPid[pid] -= pageSize;
+
+	//blocks of the page cannot stay in the caches under the old address (their contents move with the page)
+	if (lastLevelCache != 0){
+		for (addrint offset = 0; offset < pageSize; offset += blockSize){
+			lastLevelCache->functionalFlush(getAddress(physicalPage, offset));
+		}
+	}
+
+	it->second.page = *destPhysicalPage;
+	it->second.type = DRAM;
+	physicalPages.erase(pit);
+	bool ins = physicalPages.emplace(*destPhysicalPage, PhysicalPageEntry(pid, virtualPage)).second;
+	myassert(ins);
+
+	policies[pid]->done(pid, virtualPage);
+	return true;
+}
+
 void HybridMemoryManager::finish(int core){
 	coresFinished.insert(core);
 //	if (perPageStats){
@@ -375,7 +463,8 @@ void HybridMemoryManager::allocate(const vector<string>& filenames){
 				dramFreePageList.pop_front();
 				dramMemorySizeInitial += pageSize;
 				dramMemorySizeUsedPerPid[pid] += pageSize;
-			} else if (type == PCM){
+			} else {
+				myassert(type == PCM);
 				if (pcmFreePageList.empty()){
 					error("PCM free page list is empty");
 				}
@@ -383,8 +472,6 @@ void HybridMemoryManager::allocate(const vector<string>& filenames){
 				pcmFreePageList.pop_front();
 				pcmMemorySizeInitial += pageSize;
 				pcmMemorySizeUsedPerPid[pid] += pageSize;
-			} else {
-				myassert(false);
 			}
 			PageMap::iterator it = pages[pid].emplace(virtualPage, PageEntry(freePage, type, engine->getTimestamp())).first;
 			bool ins = physicalPages.emplace(it->second.page, PhysicalPageEntry(pid, virtualPage)).second;
@@ -420,6 +507,136 @@ void HybridMemoryManager::allocate(const vector<string>& filenames){
 //	}
 }
 
+static void saveFreePageList(CheckpointWriter *cp, const list<addrint>& freeList){
+	cp->write<uint64>(freeList.size());
+	for (auto it = freeList.begin(); it != freeList.end(); ++it){
+		cp->write(*it);
+	}
+}
+
+static void restoreFreePageList(CheckpointReader *cp, list<addrint> *freeList){
+	freeList->clear();
+	uint64 size = cp->read<uint64>();
+	for (uint64 i = 0; i < size; i++){
+		freeList->emplace_back(cp->read<addrint>());
+	}
+}
+
+/*
+ * On demand promotions only copy the blocks that are accessed, so they can still be in progress when the simulation ends.
+ * They are recorded as finished so that the checkpoint does not depend on the state of the copy.
+ */
+void HybridMemoryManager::finishOnDemandMigrations(){
+	auto mig = migrations.begin();
+	while (mig != migrations.end()){
+		if (mig->second.state != COPY || mig->second.dest != DRAM || mig->second.rolledBack){
+			++mig;
+			continue;
+		}
+		PageMap::iterator it = pages[mig->second.pid].find(mig->second.virtualPage);
+		myassert(it != pages[mig->second.pid].end());
+		it->second.page = mig->second.destPhysicalPage;
+		it->second.type = DRAM;
+		bool sectored = memory->getCopiedSectors(mig->first, &it->second.validSectors);
+		if (sectored){
+			it->second.backingPage = mig->first;
+			sectoredPages++;
+		} else {
+			pcmFreePageList.emplace_back(mig->first);
+			pcmMemorySizeUsedPerPid[mig->second.pid] -= pageSize;
+			physicalPages.erase(mig->first);
+		}
+		bool ins = physicalPages.emplace(mig->second.destPhysicalPage, PhysicalPageEntry(mig->second.pid, mig->second.virtualPage)).second;
+		myassert(ins);
+		it->second.stallOnAccess = false;
+		it->second.isMigrating = false;
+		policies[mig->second.pid]->done(mig->second.pid, mig->second.virtualPage);
+		copyQueue.remove(mig->first);
+		mig = migrations.erase(mig);
+		migrationTableSize--;
+	}
+}
+
+void HybridMemoryManager::saveCheckpoint(CheckpointWriter *cp){
+	finishOnDemandMigrations();
+	if (!migrations.empty() || !flushQueue.empty() || !stalledRequests.empty()){
+		error("%s cannot be checkpointed while migrations are in progress", name.c_str());
+	}
+	cp->writeString("hybrid");
+	cp->write(numProcesses);
+	cp->write(pageSize);
+	cp->write(numDramPages);
+	cp->write(numPcmPages);
+	for (unsigned pid = 0; pid < numProcesses; pid++){
+		cp->write<uint64>(pages[pid].size());
+		for (auto it = pages[pid].begin(); it != pages[pid].end(); ++it){
+			cp->write(it->first);
+			cp->write(it->second.page);
+			cp->write(it->second.type);
+			cp->write(it->second.backingPage);
+			cp->write<uint32>(it->second.validSectors.size());
+			for (unsigned i = 0; i < it->second.validSectors.size(); i++){
+				cp->write<bool>(it->second.validSectors[i]);
+			}
+		}
+	}
+	cp->write<uint64>(physicalPages.size());
+	for (auto it = physicalPages.begin(); it != physicalPages.end(); ++it){
+		cp->write(it->first);
+		cp->write(it->second.pid);
+		cp->write(it->second.virtualPage);
+	}
+	saveFreePageList(cp, dramFreePageList);
+	saveFreePageList(cp, pcmFreePageList);
+	cp->write(sectoredPages);
+	cp->write(idle);
+	cp->write(lastStartIdleTime);
+	cp->write(currentPolicy);
+	cp->write(lastIntervalStart);
+}
+
+/*
+ * Replaces the pages allocated by allocate() with the ones in the checkpoint, unless it was taken with a different memory organization
+ */
+bool HybridMemoryManager::restoreCheckpoint(CheckpointReader *cp){
+	string type;
+	cp->readString(&type);
+	if (type != "hybrid" || cp->read<unsigned>() != numProcesses || cp->read<unsigned>() != pageSize || cp->read<uint64>() != numDramPages || cp->read<uint64>() != numPcmPages){
+		return false;
+	}
+	for (unsigned pid = 0; pid < numProcesses; pid++){
+		pages[pid].clear();
+		uint64 numPages = cp->read<uint64>();
+		for (uint64 i = 0; i < numPages; i++){
+			addrint virtualPage = cp->read<addrint>();
+			addrint page = cp->read<addrint>();
+			PageType type = cp->read<PageType>();
+			PageEntry *entry = &pages[pid].emplace(virtualPage, PageEntry(page, type, 0)).first->second;
+			cp->read(&entry->backingPage);
+			entry->validSectors.resize(cp->read<uint32>());
+			for (unsigned j = 0; j < entry->validSectors.size(); j++){
+				entry->validSectors[j] = cp->read<bool>();
+			}
+		}
+	}
+	physicalPages.clear();
+	uint64 numPhysicalPages = cp->read<uint64>();
+	for (uint64 i = 0; i < numPhysicalPages; i++){
+		addrint page = cp->read<addrint>();
+		int pid = cp->read<int>();
+		addrint virtualPage = cp->read<addrint>();
+		physicalPages.emplace(page, PhysicalPageEntry(pid, virtualPage));
+	}
+	restoreFreePageList(cp, &dramFreePageList);
+	restoreFreePageList(cp, &pcmFreePageList);
+	cp->read(&sectoredPages);
+	cp->read(&idle);
+	cp->read(&lastStartIdleTime);
+	cp->read(&currentPolicy);
+	cp->read(&lastIntervalStart);
+	return true;
+}
+
 void HybridMemoryManager::process(const Event * event){
 	uint64 timestamp = engine->getTimestamp();
 	EventType type = static_cast<EventType>(event->getData());
@@ -432,12 +649,10 @@ void HybridMemoryManager::process(const Event * event){
 	} else if (type == ROLLBACK){
 
 	} else if (type == COPY_PAGE){
-		auto mig = migrations.begin();
-		while(mig != migrations.end() && !mig->second.needsCopying){
-			++mig;
-		}
+		myassert(!copyQueue.empty());
+		auto mig = migrations.find(copyQueue.front());
+		copyQueue.pop_front();
 		myassert(mig != migrations.end());
-		mig->second.needsCopying = false;
 		memory->copyPage(mig->first, mig->second.destPhysicalPage);
 		mig->second.startCopyTime = timestamp;
 	} else if (type == UPDATE_PARTITION){
@@ -514,11 +729,18 @@ bool HybridMemoryManager::startDemotion(int policy){
 			myassert(isDramPage(it->second.page));
 			myassert(it->second.type == DRAM);
 			it->second.isMigrating = true;
-			if (pcmFreePageList.empty()){
-				error("PCM free page list is empty");
+			addrint destPhysPage;
+			bool toBackingPage = !it->second.validSectors.empty();
+			if (toBackingPage){
+				//sectors that were never copied to DRAM are still in the backing page
+				destPhysPage = it->second.backingPage;
+			} else {
+				if (pcmFreePageList.empty()){
+					error("PCM free page list is empty");
+				}
+				destPhysPage = pcmFreePageList.front();
+				pcmFreePageList.pop_front();
 			}
-			addrint destPhysPage = pcmFreePageList.front();
-			pcmFreePageList.pop_front();
 
 			State state;
 			if (flushPolicy == FLUSH_PCM_BEFORE){
@@ -530,11 +752,10 @@ bool HybridMemoryManager::startDemotion(int policy){
 			} else if (flushPolicy == REMAP){
 				state = COPY;
 				memory->copyPage(it->second.page, destPhysPage);
-			} else if (flushPolicy == CHANGE_TAG){
+			} else {
+				myassert(flushPolicy == CHANGE_TAG);
 				state = COPY;
 				memory->copyPage(it->second.page, destPhysPage);
-			} else {
-				myassert(false);
 			}
 
 			bool ins = migrations.emplace(it->second.page, MigrationEntry(pid, virtualPage, destPhysPage, PCM, state, timestamp)).second;
@@ -551,7 +772,9 @@ bool HybridMemoryManager::startDemotion(int policy){
 			migrationEntriesSum += migrations.size();
 			migrationEntriesCount++;
 			pcmMigrationsPerPid[pid]++;
-			pcmMemorySizeUsedPerPid[pid] += pageSize;
+			if (!toBackingPage){
+				pcmMemorySizeUsedPerPid[pid] += pageSize;
+			}
 
 			//for per page statistics
 	//		myassert(it->second.migrations.back().end == 0);
@@ -573,7 +796,6 @@ bool HybridMemoryManager::startDemotion(int policy){
 }
 
 void HybridMemoryManager::updateMonitors(){
-	monitors.clear();
 	progress.clear();
 	memory->readCountsAndProgress(&monitors,&progress);
 
@@ -586,10 +808,10 @@ void HybridMemoryManager::updateMonitors(){
 			} else {
 				warn("%lu: Why is this page (%lu) not in the physical map?", engine->getTimestamp(), mit->page);
 				for (unsigned i = 0; i < pageSize/blockSize; i++){
-					if (mit->readBlocks[i] != 0){
+					if (mit->readBlocks[i]){
 						cout << "read: " << getAddressFromBlock(mit->page, i) << endl;
 					}
-					if (mit->writtenBlocks[i] != 0){
+					if (mit->writtenBlocks[i]){
 						cout << "written: " << getAddressFromBlock(mit->page, i) << endl;
 					}
 				}
@@ -764,9 +986,17 @@ void HybridMemoryManager::finishFlushing(addrint srcPhysicalPage){
 		//update per page statistics
 		//it->second.migrations.back().endTransfer = timestamp;
 
-		PhysicalPageMap::iterator ppit = physicalPages.find(mig->first);
-		myassert(ppit != physicalPages.end());
-		physicalPages.erase(ppit);
+		//the page is copied back to its old PCM page, so only the sectors that made it to DRAM need to be copied
+		bool sectored = memory->getCopiedSectors(mig->first, &it->second.validSectors);
+		if (sectored){
+			it->second.backingPage = mig->first;
+			sectoredPages++;
+			sectoredPromotions++;
+		} else {
+			PhysicalPageMap::iterator ppit = physicalPages.find(mig->first);
+			myassert(ppit != physicalPages.end());
+			physicalPages.erase(ppit);
+		}
 		bool ins = physicalPages.emplace(mig->second.destPhysicalPage, PhysicalPageEntry(mig->second.pid, mig->second.virtualPage)).second;
 		myassert(ins);
 
@@ -784,6 +1014,8 @@ void HybridMemoryManager::finishFlushing(addrint srcPhysicalPage){
 		dramFullMigrationTime += migrationTime;
 		dramFlushAfterTime += flushTime;
 
+		logMigration(logFlushAfter, mig->second.startFlushTime, timestamp, mig);
+		logMigration(logPromotion, mig->second.startMigrationTime, timestamp, mig);
 		migrations.erase(mig);
 
 		memory->copyPage(it->second.page, destPhysPage);
@@ -796,7 +1028,9 @@ void HybridMemoryManager::finishFlushing(addrint srcPhysicalPage){
 		migrationEntriesSum += migrations.size();
 		migrationEntriesCount++;
 		pcmMigrationsPerPid[pid]++;
-		pcmMemorySizeUsedPerPid[pid] += pageSize;
+		if (!sectored){
+			pcmMemorySizeUsedPerPid[pid] += pageSize;
+		}
 
 		//for per page statistics
 		//myassert(it->second.migrations.back().end == 0);
@@ -804,10 +1038,11 @@ void HybridMemoryManager::finishFlushing(addrint srcPhysicalPage){
 		//it->second.migrations.emplace_back(PCM, timestamp);
 	} else {
 		if (mig->second.state == FLUSH_BEFORE){
+			logMigration(logFlushBefore, mig->second.startFlushTime, timestamp, mig);
 			mig->second.state = COPY;
 			it->second.stallOnAccess = false;
 
-			mig->second.needsCopying = true;
+			copyQueue.emplace_back(mig->first);
 			addEvent(0, COPY_PAGE);
 			unstallCpus(mig->second.pid, mig->second.virtualPage);
 
@@ -826,12 +1061,28 @@ void HybridMemoryManager::finishFlushing(addrint srcPhysicalPage){
 
 			it->second.page = mig->second.destPhysicalPage;
 			it->second.type = mig->second.dest;
+			bool sectored = false;
 			if (it->second.type == DRAM) {
-				pcmFreePageList.emplace_back(mig->first);
-				pcmMemorySizeUsedPerPid[mig->second.pid] -= pageSize;
+				sectored = memory->getCopiedSectors(mig->first, &it->second.validSectors);
+				if (sectored){
+					//keep the PCM page as backing for the sectors that were not copied
+					it->second.backingPage = mig->first;
+					sectoredPages++;
+					sectoredPromotions++;
+				} else {
+					pcmFreePageList.emplace_back(mig->first);
+					pcmMemorySizeUsedPerPid[mig->second.pid] -= pageSize;
+				}
 			} else if (it->second.type == PCM){
 				dramFreePageList.emplace_back(mig->first);
 				dramMemorySizeUsedPerPid[mig->second.pid] -= pageSize;
+				if (!it->second.validSectors.empty()){
+					//page was demoted to its own backing page
+					myassert(it->second.backingPage == mig->second.destPhysicalPage);
+					physicalPages.erase(it->second.backingPage);
+					it->second.validSectors.clear();
+					sectoredPages--;
+				}
 			} else {
 				myassert(false);
 			}
@@ -841,9 +1092,11 @@ void HybridMemoryManager::finishFlushing(addrint srcPhysicalPage){
 			//update per page statistics
 			//it->second.migrations.back().endTransfer = timestamp;
 
-			PhysicalPageMap::iterator ppit = physicalPages.find(mig->first);
-			myassert(ppit != physicalPages.end());
-			physicalPages.erase(ppit);
+			if (!sectored){
+				PhysicalPageMap::iterator ppit = physicalPages.find(mig->first);
+				myassert(ppit != physicalPages.end());
+				physicalPages.erase(ppit);
+			}
 			bool ins = physicalPages.emplace(mig->second.destPhysicalPage, PhysicalPageEntry(mig->second.pid, mig->second.virtualPage)).second;
 			myassert(ins);
 
@@ -874,6 +1127,8 @@ void HybridMemoryManager::finishFlushing(addrint srcPhysicalPage){
 				error("Invalid page type");
 			}
 
+			logMigration(logFlushAfter, mig->second.startFlushTime, timestamp, mig);
+			logMigration(mig->second.dest == DRAM ? logPromotion : logDemotion, mig->second.startMigrationTime, timestamp, mig);
 			migrations.erase(mig);
 			migrationTableSize--;
 
@@ -913,9 +1168,12 @@ void HybridMemoryManager::copyCompleted(addrint srcPhysicalPage){
 
 		demoting = false;
 		addEvent(1, DEMOTE);
+		logMigration(logCopy, mig->second.startCopyTime, timestamp, mig);
+		logMigration(logRollback, mig->second.startMigrationTime, timestamp, mig);
 		migrations.erase(mig);
 		migrationTableSize--;
 	} else {
+		logMigration(logCopy, mig->second.startCopyTime, timestamp, mig);
 		mig->second.state = FLUSH_AFTER;
 		it->second.stallOnAccess = true;
 		if (flushPolicy == FLUSH_PCM_BEFORE || flushPolicy == FLUSH_ONLY_AFTER){
@@ -990,7 +1248,7 @@ void HybridMemoryManager::unstallCpus(int pid, addrint virtualPage){
 }
 
 bool HybridMemoryManager::arePagesCompatible(addrint page1, addrint page2) const {
-	if (flushPolicy == FLUSH_PCM_BEFORE || flushPolicy == FLUSH_ONLY_AFTER || REMAP){
+	if (flushPolicy == FLUSH_PCM_BEFORE || flushPolicy == FLUSH_ONLY_AFTER || flushPolicy == REMAP){
 		return true;
 	} else if (flushPolicy == CHANGE_TAG){
 		return lastLevelCache->isSameSet(getAddress(page1, 0), getAddress(page2, 0));
@@ -1026,6 +1284,88 @@ int HybridMemoryManager::getPidOfAddress(addrint addr){
 	}
 }
 
+void HybridMemoryManager::monitorPhysicalPage(addrint physicalPage){
+	if (!monitorPartition){
+		return;
+	}
+	PhysicalPageMap::iterator it = physicalPages.find(physicalPage);
+	if (it != physicalPages.end()){
+		partition->monitor(partition->getNumPolicies() == 1 ? 0 : it->second.pid, it->second.virtualPage);
+	}
+}
+
+const vector<bool> *HybridMemoryManager::getValidSectors(addrint physicalPage){
+	if (sectoredPages == 0){
+		return 0;
+	}
+	int pid;
+	PageEntry *entry = findPhysicalPage(physicalPage, &pid);
+	if (entry == 0 || entry->validSectors.empty()){
+		return 0;
+	}
+	return &entry->validSectors;
+}
+
+bool HybridMemoryManager::getSectorBacking(addrint physicalPage, unsigned sector, addrint *backingPage){
+	if (sectoredPages == 0){
+		return false;
+	}
+	int pid;
+	PageEntry *entry = findPhysicalPage(physicalPage, &pid);
+	if (entry == 0 || entry->validSectors.empty() || entry->validSectors[sector]){
+		return false;
+	}
+	*backingPage = entry->backingPage;
+	return true;
+}
+
+void HybridMemoryManager::sectorFetched(addrint physicalPage, unsigned sector){
+	uint64 timestamp = engine->getTimestamp();
+	debug("(%lu, %u)", physicalPage, sector);
+	int pid;
+	PageEntry *entry = findPhysicalPage(physicalPage, &pid);
+	if (entry == 0 || entry->validSectors.empty() || entry->isMigrating){
+		//page is being demoted to its backing page, which already holds the sector
+		return;
+	}
+	entry->validSectors[sector] = true;
+	for (auto it = entry->validSectors.begin(); it != entry->validSectors.end(); ++it){
+		if (!*it){
+			return;
+		}
+	}
+	releaseBackingPage(entry, pid);
+}
+
+HybridMemoryManager::PageEntry *HybridMemoryManager::findPhysicalPage(addrint physicalPage, int *pid){
+	auto pit = physicalPages.find(physicalPage);
+	if (pit == physicalPages.end()){
+		return 0;
+	}
+	auto it = pages[pit->second.pid].find(pit->second.virtualPage);
+	myassert(it != pages[pit->second.pid].end());
+	if (it->second.page != physicalPage){
+		//physicalPage is the backing page of a DRAM page
+		return 0;
+	}
+	*pid = pit->second.pid;
+	return &it->second;
+}
+
+void HybridMemoryManager::releaseBackingPage(PageEntry *entry, int pid){
+	uint64 timestamp = engine->getTimestamp();
+	debug("(%lu, %d)", entry->backingPage, pid);
+	myassert(entry->type == DRAM && !entry->validSectors.empty());
+	auto ppit = physicalPages.find(entry->backingPage);
+	myassert(ppit != physicalPages.end());
+	physicalPages.erase(ppit);
+	pcmFreePageList.emplace_back(entry->backingPage);
+	pcmMemorySizeUsedPerPid[pid] -= pageSize;
+	entry->validSectors.clear();
+	sectoredPages--;
+	backingPagesReleased++;
+}
+
 void HybridMemoryManager::addCpu(CPU *cpu){
 	cpus.emplace_back(cpu);
 }
@@ -1085,6 +1425,7 @@ OldHybridMemoryManager::OldHybridMemoryManager(
 		memory(memoryArg),
 		policies(policiesArg),
 		partition(partitionArg),
+		monitorPartition(partitionArg->needsMonitoring()),
 		mechanism(mechanismArg),
 		monitoringType(monitoringTypeArg),
 		monitoringLocation(monitoringLocationArg),
@@ -1282,15 +1623,14 @@ bool OldHybridMemoryManager::access(int pid, addrint virtualAddr, bool read, boo
 			freePage = dramFreePageList.front();
 			dramFreePageList.pop_front();
 			dramMemorySizeUsedPerPid[pid] += pageSize;
-		} else if (type == PCM){
+		} else {
+			myassert(type == PCM);
 			if (pcmFreePageList.empty()){
 				error("PCM free page list is empty");
 			}
 			freePage = pcmFreePageList.front();
 			pcmFreePageList.pop_front();
 			pcmMemorySizeUsedPerPid[pid] += pageSize;
-		} else {
-			myassert(false);
 		}
 		it = pages[pid].emplace(virtualPage, PageEntry(freePage, type, timestamp)).first;
 		bool ins = physicalPages.emplace(it->second.page, PhysicalPageEntry(pid, virtualPage)).second;
@@ -1329,6 +1669,11 @@ bool OldHybridMemoryManager::access(int pid, addrint virtualAddr, bool read, boo
 
 }
 
+addrint OldHybridMemoryManager::functionalAccess(int pid, addrint virtualAddr, bool read, bool instr){
+	error("%s does not support functional warmup", name.c_str());
+	return 0;
+}
+
 void OldHybridMemoryManager::finish(int core){
 	coresFinished.insert(core);
 
@@ -1441,15 +1786,14 @@ void OldHybridMemoryManager::allocate(const vector<string>& filenames){
 				freePage = dramFreePageList.front();
 				dramFreePageList.pop_front();
 				dramMemorySizeUsedPerPid[pid] += pageSize;
-			} else if (type == PCM){
+			} else {
+				myassert(type == PCM);
 				if (pcmFreePageList.empty()){
 					error("PCM free page list is empty");
 				}
 				freePage = pcmFreePageList.front();
 				pcmFreePageList.pop_front();
 				pcmMemorySizeUsedPerPid[pid] += pageSize;
-			} else {
-				myassert(false);
 			}
 			PageMap::iterator it = pages[pid].emplace(virtualPage, PageEntry(freePage, type, engine->getTimestamp())).first;
 			bool ins = physicalPages.emplace(it->second.page, PhysicalPageEntry(pid, virtualPage)).second;
@@ -1502,6 +1846,9 @@ void OldHybridMemoryManager::monitorPhysicalAccess(addrint addr, bool read, bool
 			last.writes++;
 			last.writtenBlocks.set(getBlock(addr));
 		}
+		if (monitorPartition){
+			partition->monitor(pidToPolicy[it->second.pid], it->second.virtualPage);
+		}
 	} else {
 		cout << "Couldn't find page in physical page map" << endl;
 		myassert(false);
@@ -1828,7 +2175,7 @@ void OldHybridMemoryManager::flushCompleted(addrint addr, bool dirty, IMemory *c
 	myassert(getIndex(addr) == currentMigration.srcPhysicalPage);
 	flushQueue.erase(addr);
 	debug(" flushQueue.size(): %lu", flushQueue.size());
-	if (DEBUG){
+	if (DEBUG_LEVEL >= 1){
 		if (flushQueue.size() == 1){
 			debug("flushQueue.begin: %lu", flushQueue.begin()->first);
 		}
@@ -2107,7 +2454,7 @@ void OldHybridMemoryManager::unstallCpus(int pid, addrint virtualPage){
 }
 
 bool OldHybridMemoryManager::arePagesCompatible(addrint page1, addrint page2) const {
-	if (flushPolicy == FLUSH_PCM_BEFORE || flushPolicy == FLUSH_ONLY_AFTER || REMAP){
+	if (flushPolicy == FLUSH_PCM_BEFORE || flushPolicy == FLUSH_ONLY_AFTER || flushPolicy == REMAP){
 		return true;
 	} else if (flushPolicy == CHANGE_TAG){
 		return lastLevelCache->isSameSet(getAddress(page1, 0), getAddress(page2, 0));
@@ -2318,6 +2665,12 @@ bool SimpleMemoryManager::access(int pid, addrint virtualAddr, bool read, bool i
 	return false;
 }
 
+addrint SimpleMemoryManager::functionalAccess(int pid, addrint virtualAddr, bool read, bool instr){
+	addrint physicalAddr;
+	access(pid, virtualAddr, read, instr, &physicalAddr, 0);
+	return physicalAddr;
+}
+
 void SimpleMemoryManager::finish(int coreId){
 
 }
@@ -2332,10 +2685,45 @@ void SimpleMemoryManager::allocate(const vector<string>& filenames){
 			}
 			addrint freePage = freePageList.front();
 			freePageList.pop_front();
-			bool ins = pages[pid].emplace(virtualPage, freePage).second;
-			assert(ins);
+			if (!pages[pid].emplace(virtualPage, freePage).second){
+				error("SimpleMemoryManager::allocate(): page %lu of process %u is listed more than once", virtualPage, pid);
+			}
+		}
+	}
+}
+
+void SimpleMemoryManager::saveCheckpoint(CheckpointWriter *cp){
+	cp->writeString("simple");
+	cp->write(numProcesses);
+	cp->write(pageSize);
+	cp->write(numPages);
+	for (unsigned pid = 0; pid < numProcesses; pid++){
+		cp->write<uint64>(pages[pid].size());
+		for (auto it = pages[pid].begin(); it != pages[pid].end(); ++it){
+			cp->write(it->first);
+			cp->write(it->second);
+		}
+	}
+	saveFreePageList(cp, freePageList);
+}
+
+bool SimpleMemoryManager::restoreCheckpoint(CheckpointReader *cp){
+	string type;
+	cp->readString(&type);
+	if (type != "simple" || cp->read<unsigned>() != numProcesses || cp->read<unsigned>() != pageSize || cp->read<uint64>() != numPages){
+		return false;
+	}
+	for (unsigned pid = 0; pid < numProcesses; pid++){
+		pages[pid].clear();
+		uint64 numEntries = cp->read<uint64>();
+		for (uint64 i = 0; i < numEntries; i++){
+			addrint virtualPage = cp->read<addrint>();
+			addrint physicalPage = cp->read<addrint>();
+			pages[pid].emplace(virtualPage, physicalPage);
 		}
 	}
+	restoreFreePageList(cp, &freePageList);
+	return true;
 }
 
 
@@ -166,6 +166,25 @@ void BaseMigrationPolicy::setNumDramPages(uint64 dramPagesNew){
 	maxFreeDramPages = dramPages * maxFreeDram;
 }
 
+void BaseMigrationPolicy::saveCheckpoint(CheckpointWriter *cp){
+	cp->write(dramPages);
+	cp->write(dramPagesLeft);
+	cp->write(dramFull);
+	cp->writeVector(progress);
+}
+
+/*
+ * The policies hold the location of every page, so they must be restored together with the memory manager
+ */
+bool BaseMigrationPolicy::restoreCheckpoint(CheckpointReader *cp){
+	cp->read(&dramPages);
+	cp->read(&dramPagesLeft);
+	cp->read(&dramFull);
+	cp->readVector(&progress);
+	maxFreeDramPages = dramPages * maxFreeDram;
+	return true;
+}
+
 NoMigrationPolicy::NoMigrationPolicy(
 	const string& nameArg,
 	Engine *engineArg,
@@ -213,8 +232,13 @@ MultiQueueMigrationPolicy::MultiQueueMigrationPolicy(
 		promotionFilter(promotionFilterArg),
 		demotionAttempts(demotionAttemptsArg){
 
-	queues[DRAM].resize(numQueues);
-	queues[PCM].resize(numQueues);
+	if (numQueues > 64){
+		error("Number of queues (%u) must not be larger than 64", numQueues);
+	}
+
+	queues.resize(2 * numQueues + 2);
+	victims = 2 * numQueues;
+	history = 2 * numQueues + 1;
 	thresholds.resize(numQueues);
 
 	for (unsigned i = 0; i < numQueues - 1; i++) {
@@ -228,6 +252,9 @@ MultiQueueMigrationPolicy::MultiQueueMigrationPolicy(
 
 	tries = demotionAttempts;
 
+	nextExpiration = numeric_limits<uint64>::max();
+	demotableQueues = 0;
+
 	myassert(thresholdQueue > 0);
 }
 
@@ -254,21 +281,19 @@ MultiQueueMigrationPolicy::MultiQueueMigrationPolicy(
 PageType MultiQueueMigrationPolicy::allocate(int pid, addrint addr, bool read, bool instr){
 	int index = numPids == 1 ? 0 : pid;
 	PageType ret = BaseMigrationPolicy::allocate(pid, addr, read, instr);
+	uint32 entry = entries.size();
 	if (ret == DRAM){
 		uint64 exp = (logicalTime ? currentTime : engine->getTimestamp()) + lifetime;
-		//uint64 count = thresholds[thresholdQueue-1];
-		//auto ait = queues[DRAM][thresholdQueue].emplace(queues[DRAM][thresholdQueue].end(), AccessEntry(pid, addr, exp, count, false, false));
 		uint64 count = 0;
-		auto ait = queues[DRAM][0].emplace(queues[DRAM][0].end(), AccessEntry(pid, addr, exp, count, false, false));
-		bool ins = pages[index].emplace(addr, PageEntry(ret, 0, ait)).second;
-		myassert(ins);
+		entries.emplace_back(AccessEntry(pid, addr, exp, count, false, false), ret, 0);
 	} else if (ret == PCM){
-		auto ait = history.emplace(history.end(), AccessEntry(pid, addr, 0, 0, false, false));
-		bool ins = pages[index].emplace(addr, PageEntry(ret, -2, ait)).second;
-		myassert(ins);
+		entries.emplace_back(AccessEntry(pid, addr, 0, 0, false, false), ret, -2);
 	} else {
 		myassert(false);
 	}
+	bool ins = pages[index].emplace(addr, entry).second;
+	myassert(ins);
+	pushBack(entry);
 	return ret;
 }
 
@@ -277,30 +302,18 @@ bool MultiQueueMigrationPolicy::migrate(int pid, addrint addr){
 		int index = numPids == 1 ? 0 : pid;
 		auto it = pages[index].find(addr);
 		myassert(it != pages[index].end());
-		myassert(it->second.type == PCM);
-		myassert(it->second.accessIt->pid == pid);
-		myassert(it->second.accessIt->addr == addr);
-		myassert(!it->second.accessIt->migrating);
-
-		if (!promotionFilter || (promotionFilter && it->second.queue >= thresholdQueue)){
-			AccessEntry entry(*it->second.accessIt);
-			if (it->second.queue == -2){
-				history.erase(it->second.accessIt);
-			} else if (it->second.queue == -1){
-				victims.erase(it->second.accessIt);
-			} else {
-				queues[PCM][it->second.queue].erase(it->second.accessIt);
-			}
-			it->second.type = DRAM;
-			entry.migrating = true;
-			it->second.queue = 0;
-			for(unsigned i = 0; i < numQueues-1; i++){
-				if(entry.count < thresholds[i]){
-					it->second.queue = i;
-					break;
-				}
-			}
-			it->second.accessIt = queues[DRAM][it->second.queue].emplace(queues[DRAM][it->second.queue].end(), entry);
+		PageEntry *entry = &entries[it->second];
+		myassert(entry->type == PCM);
+		myassert(entry->access.pid == pid);
+		myassert(entry->access.addr == addr);
+		myassert(!entry->access.migrating);
+
+		if (!promotionFilter || (promotionFilter && entry->queue >= thresholdQueue)){
+			remove(it->second);
+			entry->type = DRAM;
+			entry->access.migrating = true;
+			entry->queue = getQueue(entry->access.count);
+			pushBack(it->second);
 			dramPagesLeft--;
 			return true;
 		} else {
@@ -311,20 +324,16 @@ bool MultiQueueMigrationPolicy::migrate(int pid, addrint addr){
 	}
 }
 
-//bool MultiQueueMigrationPolicy::complete(int *pid, addrint *addr){
-//
-//}
-//
-//bool MultiQueueMigrationPolicy::rollback(int *pid, addrint *addr){
-//
-//}
-
 void MultiQueueMigrationPolicy::done(int pid, addrint addr){
 	int index = numPids == 1 ? 0 : pid;
 	auto it = pages[index].find(addr);
 	myassert(it != pages[index].end());
-	myassert(it->second.accessIt->migrating);
-	it->second.accessIt->migrating = false;
+	PageEntry *entry = &entries[it->second];
+	myassert(entry->access.migrating);
+	entry->access.migrating = false;
+	unsigned queueIndex = getQueueIndex(entry->type, entry->queue);
+	queues[queueIndex].idle++;
+	updateDemotable(queueIndex);
 }
 
 void MultiQueueMigrationPolicy::monitor(const vector<CountEntry>& counts, const vector<ProgressEntry>& progress){
@@ -333,17 +342,18 @@ void MultiQueueMigrationPolicy::monitor(const vector<CountEntry>& counts, const
 		uint64 timestamp = engine->getTimestamp();
 		PageMap::iterator it = pages[index].find(cit->page);
 		myassert(it != pages[index].end());
+		PageEntry *entry = &entries[it->second];
 		uint64 count = cit->reads;
 
 		currentTime++;
 		uint64 exp = (logicalTime ? currentTime : timestamp) + lifetime;
-		if (it->second.queue == -2){
+		if (entry->queue == -2){
 			//bring back from history list
-			uint64 oldCount = it->second.accessIt->count + count;
-			bool oldMigrating = it->second.accessIt->migrating;
+			uint64 oldCount = entry->access.count + count;
+			bool oldMigrating = entry->access.migrating;
 			if (useHistory){
 				if (aging){
-					uint64 timeSinceExpiration = timestamp - it->second.accessIt->expirationTime;
+					uint64 timeSinceExpiration = timestamp - entry->access.expirationTime;
 					uint64 periodsSinceExpiration = timeSinceExpiration/lifetime;
 					if (periodsSinceExpiration >= 64){
 						periodsSinceExpiration = 63;
@@ -353,98 +363,70 @@ void MultiQueueMigrationPolicy::monitor(const vector<CountEntry>& counts, const
 			} else {
 				oldCount = count;
 			}
-			history.erase(it->second.accessIt);
-			it->second.queue = 0;
-			for(unsigned i = 0; i < numQueues-1; i++){
-				if(oldCount < thresholds[i]){
-					it->second.queue = i;
-					break;
-				}
-			}
-			it->second.accessIt = queues[it->second.type][it->second.queue].emplace(queues[it->second.type][it->second.queue].end(), AccessEntry(cit->pid, cit->page, exp, oldCount, false, oldMigrating));
-
-		} else if (it->second.queue == -1){
+			remove(it->second);
+			entry->queue = getQueue(oldCount);
+			entry->access = AccessEntry(cit->pid, cit->page, exp, oldCount, false, oldMigrating);
+			pushBack(it->second);
+		} else if (entry->queue == -1){
 			//bring back from victim list
-			uint64 oldCount = it->second.accessIt->count + count;
-			bool oldMigrating = it->second.accessIt->migrating;
+			uint64 oldCount = entry->access.count + count;
+			bool oldMigrating = entry->access.migrating;
 			if (aging){
-				uint64 timeSinceExpiration = timestamp - it->second.accessIt->expirationTime;
+				uint64 timeSinceExpiration = timestamp - entry->access.expirationTime;
 				uint64 periodsSinceExpiration = timeSinceExpiration/lifetime;
 				if (periodsSinceExpiration >= 64){
 					periodsSinceExpiration = 63;
 				}
 				oldCount /= static_cast<uint64>(pow(2.0l, static_cast<int>(periodsSinceExpiration)));
 			}
-			victims.erase(it->second.accessIt);
-			it->second.queue = 0;
-			for(unsigned i = 0; i < numQueues-1; i++){
-				if(oldCount < thresholds[i]){
-					it->second.queue = i;
-					break;
-				}
-			}
-			it->second.accessIt = queues[it->second.type][it->second.queue].emplace(queues[it->second.type][it->second.queue].end(), AccessEntry(cit->pid, cit->page, exp, oldCount, false, oldMigrating));
-		} else if (it->second.queue >= 0){
-			it->second.accessIt->count += count;
-			uint64 oldCount = it->second.accessIt->count;
-			bool oldMigrating = it->second.accessIt->migrating;
-			queues[it->second.type][it->second.queue].erase(it->second.accessIt);
-			it->second.queue = 0;
-			for(unsigned i = 0; i < numQueues-1; i++){
-				if(oldCount < thresholds[i]){
-					it->second.queue = i;
-					if (usePendingList && it->second.queue >= thresholdQueue){
-						pending.emplace_back(make_pair(index, it->first));
-					}
-					break;
-				}
+			remove(it->second);
+			entry->queue = getQueue(oldCount);
+			entry->access = AccessEntry(cit->pid, cit->page, exp, oldCount, false, oldMigrating);
+			pushBack(it->second);
+		} else if (entry->queue >= 0){
+			entry->access.count += count;
+			uint64 oldCount = entry->access.count;
+			bool oldMigrating = entry->access.migrating;
+			remove(it->second);
+			entry->queue = getQueue(oldCount);
+			if (usePendingList && entry->queue >= thresholdQueue){
+				pending.emplace_back(make_pair(index, it->first));
 			}
-			it->second.accessIt = queues[it->second.type][it->second.queue].emplace(queues[it->second.type][it->second.queue].end(), AccessEntry(cit->pid, cit->page, exp, oldCount, false, oldMigrating));
+			entry->access = AccessEntry(cit->pid, cit->page, exp, oldCount, false, oldMigrating);
+			pushBack(it->second);
 		} else {
 			myassert(false);
 		}
 
-		for (unsigned i = 0; i < 2; i++){
-			for (vector<AccessQueue>::iterator qit = queues[i].begin(); qit != queues[i].end(); ++qit){
-				if (!qit->empty()){
-					if((logicalTime && currentTime > qit->front().expirationTime) || (!logicalTime && timestamp > qit->front().expirationTime)){
-						int frontPid = qit->front().pid;
-						PageMap::iterator pageIt = pages[frontPid].find(qit->front().addr);
-						myassert(pageIt != pages[frontPid].end());
-						uint64 oldCount = pageIt->second.accessIt->count;
-						bool oldMigrating = pageIt->second.accessIt->migrating;
-						uint64 exp = (logicalTime ? currentTime : timestamp) + lifetime;
-						if (aging){
-							oldCount /= 2;
-						}
-						if (pageIt->second.queue == 0){
-							queues[i][pageIt->second.queue].erase(pageIt->second.accessIt);
-							if (pageIt->second.type == DRAM){
-								pageIt->second.accessIt = victims.emplace(victims.end(), AccessEntry(frontPid, pageIt->first, exp, oldCount, false, oldMigrating));
-								pageIt->second.queue = -1;
-							} else {
-								pageIt->second.accessIt = history.emplace(history.end(), AccessEntry(frontPid, pageIt->first, exp, oldCount, false, oldMigrating));
-								pageIt->second.queue = -2;
-							}
-						} else if (pageIt->second.queue > 0){
-							if (secondDemotionEviction && pageIt->second.accessIt->demoted){
-								queues[i][pageIt->second.queue].erase(pageIt->second.accessIt);
-								if (pageIt->second.type == DRAM){
-									pageIt->second.accessIt = victims.emplace(victims.end(), AccessEntry(frontPid, pageIt->first, exp, oldCount, false, oldMigrating));
-									pageIt->second.queue = -1;
-								} else {
-									pageIt->second.accessIt = history.emplace(history.end(), AccessEntry(frontPid, pageIt->first, exp, oldCount, false, oldMigrating));
-									pageIt->second.queue = -2;
-								}
-							} else {
-								queues[i][pageIt->second.queue].erase(pageIt->second.accessIt);
-								pageIt->second.queue--;
-								pageIt->second.accessIt = queues[i][pageIt->second.queue].emplace(queues[i][pageIt->second.queue].end(), AccessEntry(frontPid, pageIt->first, exp, oldCount, true, oldMigrating));
-							}
-						} else {
-							myassert(false);
-						}
+		//only the entries at the front of the queues can expire, so nothing needs to be done until the earliest of them does
+		uint64 now = logicalTime ? currentTime : timestamp;
+		if (now > nextExpiration){
+			for (unsigned i = 0; i < 2 * numQueues; i++){
+				if (queues[i].head != NIL && now > entries[queues[i].head].access.expirationTime){
+					uint32 front = queues[i].head;
+					PageEntry *frontEntry = &entries[front];
+					uint64 oldCount = frontEntry->access.count;
+					bool oldMigrating = frontEntry->access.migrating;
+					uint64 exp = now + lifetime;
+					if (aging){
+						oldCount /= 2;
+					}
+					myassert(frontEntry->queue >= 0);
+					remove(front);
+					if (frontEntry->queue == 0 || (secondDemotionEviction && frontEntry->access.demoted)){
+						frontEntry->queue = frontEntry->type == DRAM ? -1 : -2;
+						frontEntry->access = AccessEntry(frontEntry->access.pid, frontEntry->access.addr, exp, oldCount, false, oldMigrating);
+					} else {
+						frontEntry->queue--;
+						frontEntry->access = AccessEntry(frontEntry->access.pid, frontEntry->access.addr, exp, oldCount, true, oldMigrating);
 					}
+					pushBack(front);
+				}
+			}
+			nextExpiration = numeric_limits<uint64>::max();
+			for (unsigned i = 0; i < 2 * numQueues; i++){
+				if (queues[i].head != NIL && entries[queues[i].head].access.expirationTime < nextExpiration){
+					nextExpiration = entries[queues[i].head].access.expirationTime;
 				}
 			}
 		}
@@ -464,55 +446,178 @@ bool MultiQueueMigrationPolicy::selectDemotionPage(int *pid, addrint *addr){
 		return false;
 	}
 
-	auto vit = victims.begin();
-	if (!enableRollback){
-		while(vit != victims.end() && vit->migrating){
-			++vit;
-		}
-	}
-	if (vit != victims.end()){
-		AccessEntry entry = *vit;
-		PageMap::iterator pageIt = pages[entry.pid].find(entry.addr);
-		myassert(pageIt != pages[entry.pid].end());
-		myassert(pageIt->second.type == DRAM);
-		myassert(pageIt->second.queue == -1);
-		uint64 oldCount = pageIt->second.accessIt->count;
-		uint64 exp = pageIt->second.accessIt->expirationTime;
-		victims.erase(vit);
+	uint32 victim = findDemotionCandidate(victims);
+	if (victim != NIL){
+		PageEntry *pageEntry = &entries[victim];
+		AccessEntry entry = pageEntry->access;
+		myassert(pageEntry->type == DRAM);
+		myassert(pageEntry->queue == -1);
+		uint64 oldCount = entry.count;
+		uint64 exp = entry.expirationTime;
+		remove(victim);
 		*pid = entry.pid;
 		*addr = entry.addr;
-		pageIt->second.type = PCM;
-		pageIt->second.accessIt = history.emplace(history.end(), AccessEntry(entry.pid, entry.addr, pageIt->second.type, exp, oldCount, true));
-		pageIt->second.queue = -2;
+		pageEntry->type = PCM;
+		pageEntry->access = AccessEntry(entry.pid, entry.addr, pageEntry->type, exp, oldCount, true);
+		pageEntry->queue = -2;
+		pushBack(victim);
 		dramPagesLeft++;
 		return true;
 	} else {
-		for (int i = 0; i < thresholdQueue; i++) {
-			if (!queues[DRAM][i].empty()){
-				auto qit = queues[DRAM][i].begin();
-				if (!enableRollback){
-					while (qit != queues[DRAM][i].end() && qit->migrating){
-						++qit;
-					}
-				}
-				if (qit != queues[DRAM][i].end()){
-					AccessEntry entry(*qit);
-					queues[DRAM][i].erase(qit);
-					*pid = entry.pid;
-					*addr = entry.addr;
-					PageMap::iterator pageIt = pages[*pid].find(*addr);
-					pageIt->second.type = PCM;
-					entry.migrating = true;
-					pageIt->second.accessIt = queues[PCM][pageIt->second.queue].emplace(queues[PCM][pageIt->second.queue].end(), entry);
-					dramPagesLeft++;
-					return true;
-				}
-			}
+		uint64 candidates = demotableQueues;
+		if (thresholdQueue < 64){
+			candidates &= (static_cast<uint64>(1) << thresholdQueue) - 1;
+		}
+		if (candidates != 0){
+			//lowest DRAM queue below the threshold queue with an entry that can be demoted
+			uint32 candidate = findDemotionCandidate(__builtin_ctzll(candidates));
+			myassert(candidate != NIL);
+			PageEntry *pageEntry = &entries[candidate];
+			remove(candidate);
+			*pid = pageEntry->access.pid;
+			*addr = pageEntry->access.addr;
+			pageEntry->type = PCM;
+			pageEntry->access.migrating = true;
+			pushBack(candidate);
+			dramPagesLeft++;
+			return true;
 		}
 		return false;
 	}
 }
 
+int MultiQueueMigrationPolicy::getQueue(uint64 count) const {
+	for(unsigned i = 0; i < numQueues-1; i++){
+		if(count < thresholds[i]){
+			return i;
+		}
+	}
+	return 0;
+}
+
+void MultiQueueMigrationPolicy::pushBack(uint32 index){
+	PageEntry *entry = &entries[index];
+	unsigned queueIndex = getQueueIndex(entry->type, entry->queue);
+	AccessQueue *queue = &queues[queueIndex];
+	entry->prev = queue->tail;
+	entry->next = NIL;
+	if (queue->tail == NIL){
+		queue->head = index;
+		if (entry->queue >= 0 && entry->access.expirationTime < nextExpiration){
+			nextExpiration = entry->access.expirationTime;
+		}
+	} else {
+		entries[queue->tail].next = index;
+	}
+	queue->tail = index;
+	queue->size++;
+	if (!entry->access.migrating){
+		queue->idle++;
+	}
+	updateDemotable(queueIndex);
+}
+
+void MultiQueueMigrationPolicy::remove(uint32 index){
+	PageEntry *entry = &entries[index];
+	unsigned queueIndex = getQueueIndex(entry->type, entry->queue);
+	AccessQueue *queue = &queues[queueIndex];
+	if (entry->prev == NIL){
+		queue->head = entry->next;
+		if (entry->next != NIL && entry->queue >= 0 && entries[entry->next].access.expirationTime < nextExpiration){
+			nextExpiration = entries[entry->next].access.expirationTime;
+		}
+	} else {
+		entries[entry->prev].next = entry->next;
+	}
+	if (entry->next == NIL){
+		queue->tail = entry->prev;
+	} else {
+		entries[entry->next].prev = entry->prev;
+	}
+	entry->prev = NIL;
+	entry->next = NIL;
+	queue->size--;
+	if (!entry->access.migrating){
+		queue->idle--;
+	}
+	updateDemotable(queueIndex);
+}
+
+uint32 MultiQueueMigrationPolicy::findDemotionCandidate(unsigned queueIndex) const {
+	const AccessQueue& queue = queues[queueIndex];
+	if (enableRollback){
+		return queue.head;
+	}
+	if (queue.idle == 0){
+		return NIL;
+	}
+	//skip over pages being migrated (there can be at most as many as the migration table allows)
+	uint32 index = queue.head;
+	while (index != NIL && entries[index].access.migrating){
+		index = entries[index].next;
+	}
+	return index;
+}
+
+void MultiQueueMigrationPolicy::updateDemotable(unsigned queueIndex){
+	if (queueIndex < numQueues){
+		uint64 bit = static_cast<uint64>(1) << queueIndex;
+		if (enableRollback ? queues[queueIndex].size > 0 : queues[queueIndex].idle > 0){
+			demotableQueues |= bit;
+		} else {
+			demotableQueues &= ~bit;
+		}
+	}
+}
+
+void MultiQueueMigrationPolicy::saveCheckpoint(CheckpointWriter *cp){
+	BaseMigrationPolicy::saveCheckpoint(cp);
+	cp->write(numPids);
+	cp->write(numQueues);
+	cp->writeVector(entries);
+	cp->writeVector(queues);
+	cp->write(nextExpiration);
+	cp->write(currentTime);
+	cp->write(tries);
+	cp->write<uint64>(pending.size());
+	for (auto it = pending.begin(); it != pending.end(); ++it){
+		cp->write(it->first);
+		cp->write(it->second);
+	}
+}
+
+bool MultiQueueMigrationPolicy::restoreCheckpoint(CheckpointReader *cp){
+	BaseMigrationPolicy::restoreCheckpoint(cp);
+	if (cp->read<unsigned>() != numPids || cp->read<unsigned>() != numQueues){
+		error("Checkpoint of %s was taken with a different number of processes or queues", name.c_str());
+	}
+	cp->readVector(&entries);
+	cp->readVector(&queues);
+	cp->read(&nextExpiration);
+	cp->read(&currentTime);
+	cp->read(&tries);
+	pending.clear();
+	uint64 numPending = cp->read<uint64>();
+	for (uint64 i = 0; i < numPending; i++){
+		int pid = cp->read<int>();
+		addrint addr = cp->read<addrint>();
+		pending.emplace_back(pid, addr);
+	}
+	for (unsigned i = 0; i < numPids; i++){
+		pages[i].clear();
+	}
+	for (uint32 i = 0; i < entries.size(); i++){
+		int index = numPids == 1 ? 0 : entries[i].access.pid;
+		bool ins = pages[index].emplace(entries[i].access.addr, i).second;
+		myassert(ins);
+	}
+	demotableQueues = 0;
+	for (unsigned i = 0; i < numQueues; i++){
+		updateDemotable(i);
+	}
+	return true;
+}
+
 
 
 
@@ -554,15 +659,14 @@ PageType OldBaseMigrationPolicy::allocate(int pid, addrint addr, bool read, bool
 		}
 	} else if (allocPolicy == PCM_ONLY) {
 		ret = PCM;
-	} else if (allocPolicy == CUSTOM) {
+	} else {
+		myassert(allocPolicy == CUSTOM);
 		PageType hint =	allocator->hint(pid, addr, read, instr);
 		if (hint == DRAM && dramPagesLeft > 0){
 			ret = DRAM;
 		} else {
 			ret = PCM;
 		}
-	} else {
-		myassert(false);
 	}
 
 	if (ret == DRAM){
@@ -639,12 +743,11 @@ OldOfflineMigrationPolicy::OldOfflineMigrationPolicy(
 				thisPid(thisPidArg),
 				intervalCount(intervalCountArg),
 				metricThreshold(metricThresholdArg),
-				previousInterval(0){
-
-//	FILE *trace = fopen(filenameArg.c_str(), "r");
-//	if (trace == 0){
-//		error("Could not open file %s", filenameArg.c_str());
-//	}
+				previousInterval(0),
+				filename(filenameArg),
+				traceDone(false),
+				dramHeap(true),
+				pcmHeap(false){
 
 	if (metricTypeArg == "accessed"){
 		metricType = ACCESSED;
@@ -682,101 +785,28 @@ OldOfflineMigrationPolicy::OldOfflineMigrationPolicy(
 		error("Invalid weight type: %s", weightTypeArg.c_str());
 	}
 
-	gzFile trace = gzopen(filenameArg.c_str(), "r");
+	trace = gzopen(filename.c_str(), "r");
 	if (trace == 0){
-		error("Could not open file %s", filenameArg.c_str());
+		error("Could not open file %s", filename.c_str());
 	}
 
-	period = 0;
-
 	if (numPids != 1){
 		error("Sharing offline policies is not yet implemented");
 	}
 
-	bool done = false;
-	while (!done){
-		uint64 icount;
-		uint32 size;
-		//size_t read = fread(&icount, sizeof(uint64), 1, trace);
-		int read = gzread(trace, &icount, sizeof(uint64));
-		if (read > 0){
-			if (period == 0){
-				period = icount;
-			}
-			//fread(&size, sizeof(uint32), 1, trace);
-			gzread(trace, &size, sizeof(uint32));
-			for (uint32 i = 0; i < size; i++){
-				addrint page;
-				uint32 reads;
-				uint32 writes;
-				uint8 readBlocks;
-				uint8 writtenBlocks;
-				uint8 accessedBlocks;
-//				fread(&reads, sizeof(uint32), 1, trace);
-//				fread(&writes, sizeof(uint32), 1, trace);
-//				fread(&readBlocks, sizeof(uint8), 1, trace);
-//				fread(&writtenBlocks, sizeof(uint8), 1, trace);
-//				fread(&accessedBlocks, sizeof(uint8), 1, trace);
-				//fread(&page, sizeof(addrint), 1, trace);
-				gzread(trace, &page, sizeof(addrint));
-				gzread(trace, &reads, sizeof(uint32));
-				gzread(trace, &writes, sizeof(uint32));
-				gzread(trace, &readBlocks, sizeof(uint8));
-				gzread(trace, &writtenBlocks, sizeof(uint8));
-				gzread(trace, &accessedBlocks, sizeof(uint8));
-
-				uint64 readCount = 0, writeCount = 0, accessCount = 0;
-				if (metricType == ACCESSED){
-					readCount = reads == 0 ? 0 : 1;
-					writeCount = writes == 0 ? 0 : 1;
-					accessCount = readCount || writeCount;
-				} else if (metricType == ACCESS_COUNT){
-					readCount = reads;
-					writeCount = writes;
-					accessCount = readCount + writeCount;
-				} else if (metricType == TOUCH_COUNT){
-					readCount = readBlocks;
-					writeCount = writtenBlocks;
-					accessCount = accessedBlocks;
-				} else {
-					myassert(false);
-				}
-
-				uint64 count = 0;
-				if (accessType == READS){
-					count = readCount;
-				} else if (accessType == WRITES){
-					count = writeCount;
-				} else if (accessType == ACCESSES){
-					count = accessCount;
-				} else{
-					myassert(false);
-				}
-
-				PageMap::iterator pit = pages.emplace(page, PageEntry(INVALID)).first;
-				//pit->second.counters.emplace_back(Entry(icount/period, count));
-				pit->second.counters.emplace_back(icount/period, count);
-
-			}
-		} else {
-			//if (feof(trace)){
-			if (gzeof(trace)){
-				done = true;
-			} else{
-				error("Error reading file %s", filenameArg.c_str());
-			}
-		}
+	//the first interval ends after one period
+	uint64 icount;
+	if (gzread(trace, &icount, sizeof(uint64)) != sizeof(uint64) || icount == 0){
+		error("Error reading file %s", filename.c_str());
 	}
+	period = icount;
+	gzrewind(trace);
 
-	//fclose(trace);
-	gzclose(trace);
-
-//	for (PageMap::iterator it = pages.begin(); it != pages.end(); ++it){
-//		cout << it->first << endl;
-//	}
-
-	//debug = 0;
+	advanceWindow();
+}
 
+OldOfflineMigrationPolicy::~OldOfflineMigrationPolicy(){
+	gzclose(trace);
 }
 
 void OldOfflineMigrationPolicy::monitor(int pid, addrint addr){
@@ -786,35 +816,17 @@ void OldOfflineMigrationPolicy::monitor(int pid, addrint addr){
 PageType OldOfflineMigrationPolicy::allocate(int pid, addrint addr, bool read, bool instr){
 	myassert(pid == thisPid);
 	PageType ret = OldBaseMigrationPolicy::allocate(pid, addr, read, instr);
-	PageMap::iterator pit = pages.find(addr);
-	if (pit == pages.end()){
-		pit = pages.emplace(addr, PageEntry(INVALID)).first;
-	}
-	myassert(pit != pages.end());
-	myassert(pit->second.type == INVALID);
-	pit->second.cur = 0;
-	pit->second.type = ret;
-
-	while (pit->second.cur < pit->second.counters.size() && pit->second.counters[pit->second.cur].interval < previousInterval){
-		++pit->second.cur;
-	}
-	uint64 sum = 0;
-	uint64 i = pit->second.cur;
-	uint64 lastInterval = previousInterval + intervalCount;
-	while(i < pit->second.counters.size() && pit->second.counters[i].interval < lastInterval){
-		uint64 windex = pit->second.counters[i].interval - previousInterval;
-		sum += pit->second.counters[i].count * weights.at(windex);
-		++i;
-	}
-
-	if (pit->second.type == DRAM){
-		dramMetricMap.emplace(sum, pit->first);
-	} else if (pit->second.type == PCM){
-		pcmMetricMap.emplace(sum, pit->first);
+	MetricMap::const_iterator mit = windowMetrics.find(addr);
+	uint64 metric = mit == windowMetrics.end() ? 0 : mit->second;
+	pair<PageMap::iterator, bool> p = pages.emplace(addr, PageEntry(addr, ret, metric));
+	myassert(p.second);
+	if (ret == DRAM){
+		dramHeap.push(&p.first->second);
+	} else if (ret == PCM){
+		pcmHeap.push(&p.first->second);
 	} else {
 		myassert(false);
 	}
-
 	return ret;
 }
 
@@ -823,86 +835,34 @@ bool OldOfflineMigrationPolicy::selectPage(int *pid, addrint *addr){
 	uint64 curInstr = instrCounter->getTotalValue();
 	uint64 currentInterval = curInstr / period + 1;
 
-	//cout << curInstr << " " << currentInterval << endl;
-
 	if (previousInterval != currentInterval){
-//		struct timeval start;
-//		gettimeofday(&start, NULL);
-
 		previousInterval = currentInterval;
-
-		dramMetricMap.clear();
-		pcmMetricMap.clear();
-
-		uint64 lastInterval = currentInterval + intervalCount;
-
-		//cout << "currentInterval: " << currentInterval << " lastInterval: " << lastInterval << endl;
-		//if ()
-
-		for (PageMap::iterator it = pages.begin(); it != pages.end(); ++it){
-			if (it->second.type != INVALID){
-				while (it->second.cur < it->second.counters.size() && it->second.counters[it->second.cur].interval < currentInterval){
-					++it->second.cur;
-				}
-				uint64 sum = 0;
-				uint64 i = it->second.cur;
-				while(i < it->second.counters.size() && it->second.counters[i].interval < lastInterval){
-					uint64 windex = it->second.counters[i].interval - currentInterval;
-					sum += it->second.counters[i].count * weights.at(windex);
-					++i;
-				}
-
-				if (it->second.type == DRAM){
-					dramMetricMap.emplace(sum, it->first);
-				} else if (it->second.type == PCM){
-					pcmMetricMap.emplace(sum, it->first);
-				} else {
-					myassert(false);
-				}
-			}
-		}
-
-//		struct timeval end;
-//		gettimeofday(&end, NULL);
-//		long seconds  = end.tv_sec  - start.tv_sec;
-//		long useconds = end.tv_usec - start.tv_usec;
-//		long mtime = seconds * 1000000 + useconds;
-//		cout << mtime << endl;
-
+		advanceWindow();
 	}
 
 	//Find page to migrate
 
-	PcmMetricMap::iterator addrOfMaxPcmIt = pcmMetricMap.begin();
-	if (addrOfMaxPcmIt == pcmMetricMap.end() || addrOfMaxPcmIt->first == 0){
-		//warn("There are no PCM pages ranked. pcmMetricMap.size(): %lu", pcmMetricMap.size());
-//		if (engine->getTimestamp() >= debug){
-//			cout << engine->getTimestamp() << ": instruction: " << instrCounter->getTotalValue() << "No PCM pages ranked"<< endl;
-//		}
+	if (pcmHeap.empty() || pcmHeap.top()->metric == 0){
 		return false;
 	}
-	PageMap::iterator maxPcmIt = pages.find(addrOfMaxPcmIt->second);
-	myassert(maxPcmIt != pages.end());
+	PageEntry *maxPcm = pcmHeap.top();
 
 	if (dramPagesLeft <= 0){
 		//migrate to PCM
-		DramMetricMap::iterator addrOfMinDramIt = dramMetricMap.begin();
-		if (addrOfMinDramIt == dramMetricMap.end()){
-			//warn("There are no DRAM pages ranked");
+		if (dramHeap.empty()){
 			debug(": instruction: %lu. No DRAM pages ranked", instrCounter->getTotalValue());
 			return false;
 		}
-		PageMap::iterator minDramIt = pages.find(addrOfMinDramIt->second);
-		myassert(minDramIt != pages.end());
-
-		if (addrOfMaxPcmIt->first > addrOfMinDramIt->first * metricThreshold){
-			debug(": instruction: %lu; DRAM(%lu, %lu) to PCM(%lu, %lu)", instrCounter->getTotalValue(), addrOfMinDramIt->first, addrOfMinDramIt->second, addrOfMaxPcmIt->first, addrOfMaxPcmIt->second);
-			pcmMetricMap.emplace(addrOfMinDramIt->first, addrOfMinDramIt->second);
-			dramMetricMap.erase(addrOfMinDramIt);
-			myassert(minDramIt->second.type == DRAM);
+		PageEntry *minDram = dramHeap.top();
+
+		if (maxPcm->metric > minDram->metric * metricThreshold){
+			debug(": instruction: %lu; DRAM(%lu, %lu) to PCM(%lu, %lu)", instrCounter->getTotalValue(), minDram->metric, minDram->page, maxPcm->metric, maxPcm->page);
+			myassert(minDram->type == DRAM);
+			dramHeap.remove(minDram);
+			minDram->type = PCM;
+			pcmHeap.push(minDram);
 			*pid = thisPid;
-			*addr = minDramIt->first;
-			minDramIt->second.type = PCM;
+			*addr = minDram->page;
 			dramPagesLeft++;
 			return true;
 		} else {
@@ -911,19 +871,201 @@ bool OldOfflineMigrationPolicy::selectPage(int *pid, addrint *addr){
 		}
 	} else {
 		//migrate to DRAM
-		debug(": instruction: %lu; PCM(%lu, %lu) to DRAM", instrCounter->getTotalValue(), addrOfMaxPcmIt->first, addrOfMaxPcmIt->second);
-		dramMetricMap.emplace(addrOfMaxPcmIt->first, addrOfMaxPcmIt->second);
-		pcmMetricMap.erase(addrOfMaxPcmIt);
-		myassert(maxPcmIt->second.type == PCM);
+		debug(": instruction: %lu; PCM(%lu, %lu) to DRAM", instrCounter->getTotalValue(), maxPcm->metric, maxPcm->page);
+		myassert(maxPcm->type == PCM);
+		pcmHeap.remove(maxPcm);
+		maxPcm->type = DRAM;
+		dramHeap.push(maxPcm);
 		*pid = thisPid;
-		*addr = maxPcmIt->first;
-		maxPcmIt->second.type = DRAM;
+		*addr = maxPcm->page;
 		dramPagesLeft--;
 		return true;
 	}
 
 }
 
+/*
+ * Reads the counters of the next interval in the trace. Returns false at the end of the trace.
+ */
+bool OldOfflineMigrationPolicy::readInterval(Interval *interval){
+	uint64 icount;
+	uint32 size;
+	int read = gzread(trace, &icount, sizeof(uint64));
+	if (read <= 0){
+		if (gzeof(trace)){
+			return false;
+		} else {
+			error("Error reading file %s", filename.c_str());
+		}
+	}
+	gzread(trace, &size, sizeof(uint32));
+	interval->index = icount / period;
+	interval->pages.clear();
+	interval->counts.clear();
+	for (uint32 i = 0; i < size; i++){
+		addrint page;
+		uint32 reads;
+		uint32 writes;
+		uint8 readBlocks;
+		uint8 writtenBlocks;
+		uint8 accessedBlocks;
+		gzread(trace, &page, sizeof(addrint));
+		gzread(trace, &reads, sizeof(uint32));
+		gzread(trace, &writes, sizeof(uint32));
+		gzread(trace, &readBlocks, sizeof(uint8));
+		gzread(trace, &writtenBlocks, sizeof(uint8));
+		if (gzread(trace, &accessedBlocks, sizeof(uint8)) != sizeof(uint8)){
+			error("Error reading file %s", filename.c_str());
+		}
+
+		uint32 readCount = 0, writeCount = 0, accessCount = 0;
+		if (metricType == ACCESSED){
+			readCount = reads == 0 ? 0 : 1;
+			writeCount = writes == 0 ? 0 : 1;
+			accessCount = readCount || writeCount;
+		} else if (metricType == ACCESS_COUNT){
+			readCount = reads;
+			writeCount = writes;
+			accessCount = readCount + writeCount;
+		} else if (metricType == TOUCH_COUNT){
+			readCount = readBlocks;
+			writeCount = writtenBlocks;
+			accessCount = accessedBlocks;
+		} else {
+			myassert(false);
+		}
+
+		uint32 count = 0;
+		if (accessType == READS){
+			count = readCount;
+		} else if (accessType == WRITES){
+			count = writeCount;
+		} else if (accessType == ACCESSES){
+			count = accessCount;
+		} else{
+			myassert(false);
+		}
+
+		if (count != 0){
+			interval->pages.emplace_back(page);
+			interval->counts.emplace_back(count);
+		}
+	}
+	return true;
+}
+
+/*
+ * Slides the window to start at previousInterval and updates the metric of the pages accessed in the old or the new window
+ */
+void OldOfflineMigrationPolicy::advanceWindow(){
+	uint64 lastInterval = previousInterval + intervalCount;
+	while (!window.empty() && window.front().index < previousInterval){
+		window.pop_front();
+	}
+	while (!traceDone && (window.empty() || window.back().index + 1 < lastInterval)){
+		window.emplace_back();
+		if (!readInterval(&window.back())){
+			traceDone = true;
+			window.pop_back();
+		} else if (window.back().index < previousInterval){
+			window.pop_back();
+		}
+	}
+
+	MetricMap metrics;
+	for (deque<Interval>::const_iterator it = window.begin(); it != window.end() && it->index < lastInterval; ++it){
+		uint64 weight = weights[it->index - previousInterval];
+		for (uint64 i = 0; i < it->pages.size(); i++){
+			metrics[it->pages[i]] += it->counts[i] * weight;
+		}
+	}
+
+	for (MetricMap::const_iterator it = windowMetrics.begin(); it != windowMetrics.end(); ++it){
+		if (metrics.find(it->first) == metrics.end()){
+			setMetric(it->first, 0);
+		}
+	}
+	for (MetricMap::const_iterator it = metrics.begin(); it != metrics.end(); ++it){
+		setMetric(it->first, it->second);
+	}
+	windowMetrics.swap(metrics);
+}
+
+void OldOfflineMigrationPolicy::setMetric(addrint page, uint64 metric){
+	PageMap::iterator it = pages.find(page);
+	if (it != pages.end() && it->second.metric != metric){
+		it->second.metric = metric;
+		if (it->second.type == DRAM){
+			dramHeap.update(&it->second);
+		} else if (it->second.type == PCM){
+			pcmHeap.update(&it->second);
+		} else {
+			myassert(false);
+		}
+	}
+}
+
+//ties are broken by page address so that the order does not depend on the history of the heap
+bool OldOfflineMigrationPolicy::MetricHeap::before(const PageEntry *a, const PageEntry *b) const {
+	if (a->metric != b->metric){
+		return minHeap ? a->metric < b->metric : a->metric > b->metric;
+	}
+	return a->page < b->page;
+}
+
+void OldOfflineMigrationPolicy::MetricHeap::place(uint64 index, PageEntry *entry){
+	heap[index] = entry;
+	entry->heapIndex = index;
+}
+
+void OldOfflineMigrationPolicy::MetricHeap::up(uint64 index){
+	PageEntry *entry = heap[index];
+	while (index > 0 && before(entry, heap[(index - 1) / 2])){
+		place(index, heap[(index - 1) / 2]);
+		index = (index - 1) / 2;
+	}
+	place(index, entry);
+}
+
+void OldOfflineMigrationPolicy::MetricHeap::down(uint64 index){
+	PageEntry *entry = heap[index];
+	while (true){
+		uint64 child = 2 * index + 1;
+		if (child >= heap.size()){
+			break;
+		}
+		if (child + 1 < heap.size() && before(heap[child + 1], heap[child])){
+			child++;
+		}
+		if (!before(heap[child], entry)){
+			break;
+		}
+		place(index, heap[child]);
+		index = child;
+	}
+	place(index, entry);
+}
+
+void OldOfflineMigrationPolicy::MetricHeap::push(PageEntry *entry){
+	heap.emplace_back(entry);
+	up(heap.size() - 1);
+}
+
+void OldOfflineMigrationPolicy::MetricHeap::remove(PageEntry *entry){
+	uint64 index = entry->heapIndex;
+	PageEntry *last = heap.back();
+	heap.pop_back();
+	if (last != entry){
+		place(index, last);
+		update(last);
+	}
+}
+
+void OldOfflineMigrationPolicy::MetricHeap::update(PageEntry *entry){
+	up(entry->heapIndex);
+	down(entry->heapIndex);
+}
+
 
 
 
@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+#include "Monitor.H"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+CountEntry *CountTable::find(addrint page){
+	auto it = index.find(page);
+	if (it == index.end()){
+		return 0;
+	} else {
+		return &entries[it->second];
+	}
+}
+
+CountEntry *CountTable::insert(addrint page){
+	if (!index.emplace(page, entries.size()).second){
+		error("Page %lu is already in the count table", page);
+	}
+	if (spares.empty()){
+		entries.emplace_back(page, blocksPerPage);
+	} else {
+		entries.emplace_back(std::move(spares.back()));
+		spares.pop_back();
+		entries.back().reset(page, blocksPerPage);
+	}
+	return &entries.back();
+}
+
+CountEntry *CountTable::replace(uint32 pos, addrint page){
+	index.erase(entries[pos].page);
+	if (!index.emplace(page, pos).second){
+		error("Page %lu is already in the count table", page);
+	}
+	entries[pos].reset(page, blocksPerPage);
+	return &entries[pos];
+}
+
+void CountTable::move(addrint page, addrint destPage){
+	auto it = index.find(page);
+	if (it != index.end()){
+		uint32 pos = it->second;
+		entries[pos].page = destPage;
+		index.erase(it);
+		if (!index.emplace(destPage, pos).second){
+			error("Page %lu is already in the count table", destPage);
+		}
+	}
+}
+
+void CountTable::swap(vector<CountEntry> *counts){
+	counts->swap(entries);
+	for (auto it = entries.begin(); it != entries.end(); ++it){
+		spares.emplace_back(std::move(*it));
+	}
+	entries.clear();
+	index.clear();
+}
+
+
+BaseAccessMonitor::BaseAccessMonitor(const string& nameArg, const string& descArg, StatContainer *statCont) :
+	updates(statCont, nameArg + "_updates", "Number of updates to the monitoring state of the " + descArg, 0),
+	reportedPages(statCont, nameArg + "_reported_pages", "Number of page counts handed over to the migration policies by the " + descArg, 0) {
+
+}
+
+const CountEntry *BaseAccessMonitor::getCounts(addrint page){
+	return table.find(page);
+}
+
+void BaseAccessMonitor::movePage(addrint page, addrint destPage){
+	table.move(page, destPage);
+}
+
+void BaseAccessMonitor::readCounts(vector<CountEntry> *counts){
+	reportedPages += table.size();
+	table.swap(counts);
+}
+
+void BaseAccessMonitor::setBlocksPerPage(unsigned blocksPerPage){
+	table.setBlocksPerPage(blocksPerPage);
+}
+
+
+FullAccessMonitor::FullAccessMonitor(const string& nameArg, const string& descArg, StatContainer *statCont) : BaseAccessMonitor(nameArg, descArg, statCont) {
+
+}
+
+void FullAccessMonitor::access(addrint page, unsigned block, bool read){
+	CountEntry *entry = table.find(page);
+	if (entry == 0){
+		entry = table.insert(page);
+	}
+	if (read){
+		entry->reads++;
+		entry->readBlocks.set(block);
+	} else {
+		entry->writes++;
+		entry->writtenBlocks.set(block);
+	}
+	updates++;
+}
+
+
+SampledAccessMonitor::SampledAccessMonitor(const string& nameArg, const string& descArg, StatContainer *statCont, unsigned samplingPeriodArg) :
+	BaseAccessMonitor(nameArg, descArg, statCont),
+	samplingPeriod(samplingPeriodArg),
+	accessesLeft(samplingPeriodArg) {
+	if (samplingPeriod == 0){
+		error("Monitor sampling period must be larger than 0");
+	}
+}
+
+void SampledAccessMonitor::access(addrint page, unsigned block, bool read){
+	accessesLeft--;
+	if (accessesLeft != 0){
+		return;
+	}
+	accessesLeft = samplingPeriod;
+	CountEntry *entry = table.find(page);
+	if (entry == 0){
+		entry = table.insert(page);
+	}
+	if (read){
+		entry->reads++;
+		entry->readBlocks.set(block);
+	} else {
+		entry->writes++;
+		entry->writtenBlocks.set(block);
+	}
+	updates++;
+}
+
+void SampledAccessMonitor::readCounts(vector<CountEntry> *counts){
+	for (uint32 i = 0; i < table.size(); i++){
+		CountEntry *entry = table.at(i);
+		entry->reads *= samplingPeriod;
+		entry->writes *= samplingPeriod;
+	}
+	BaseAccessMonitor::readCounts(counts);
+}
+
+
+//Odd multipliers for the multiplicative hash of each row of the sketch
+static const uint64 sketchMultipliers[] = {
+	0x9E3779B97F4A7C15ULL,
+	0xC2B2AE3D27D4EB4FULL,
+	0x165667B19E3779F9ULL,
+	0xD6E8FEB86659FD93ULL,
+	0xFF51AFD7ED558CCDULL,
+	0xC4CEB9FE1A85EC53ULL,
+	0x27D4EB2F165667C5ULL,
+	0x94D049BB133111EBULL
+};
+
+static const unsigned maxSketchDepth = sizeof(sketchMultipliers) / sizeof(sketchMultipliers[0]);
+
+SketchAccessMonitor::SketchAccessMonitor(const string& nameArg, const string& descArg, StatContainer *statCont, unsigned widthArg, unsigned depthArg, uint64 thresholdArg) :
+	BaseAccessMonitor(nameArg, descArg, statCont),
+	width(widthArg),
+	depth(depthArg),
+	threshold(thresholdArg) {
+	if (width < 2 || (width & (width - 1)) != 0){
+		error("Monitor sketch width (%u) must be a power of 2 larger than 1", width);
+	}
+	if (depth == 0 || depth > maxSketchDepth){
+		error("Monitor sketch depth (%u) must be between 1 and %u", depth, maxSketchDepth);
+	}
+	logWidth = (unsigned)logb(width);
+	readSketch.resize(width * depth);
+	writeSketch.resize(width * depth);
+}
+
+unsigned SketchAccessMonitor::getCounter(addrint page, unsigned row){
+	return row * width + static_cast<unsigned>(((page + 1) * sketchMultipliers[row]) >> (64 - logWidth));
+}
+
+uint64 SketchAccessMonitor::estimate(const vector<uint32>& sketch, addrint page){
+	uint32 est = sketch[getCounter(page, 0)];
+	for (unsigned row = 1; row < depth; row++){
+		est = min(est, sketch[getCounter(page, row)]);
+	}
+	return est;
+}
+
+void SketchAccessMonitor::access(addrint page, unsigned block, bool read){
+	updates++;
+	CountEntry *entry = table.find(page);
+	if (entry == 0){
+		vector<uint32>& sketch = read ? readSketch : writeSketch;
+		for (unsigned row = 0; row < depth; row++){
+			sketch[getCounter(page, row)]++;
+		}
+		uint64 reads = estimate(readSketch, page);
+		uint64 writes = estimate(writeSketch, page);
+		if (reads + writes < threshold){
+			return;
+		}
+		entry = table.insert(page);
+		entry->reads = reads;
+		entry->writes = writes;
+		if (read){
+			entry->readBlocks.set(block);
+		} else {
+			entry->writtenBlocks.set(block);
+		}
+	} else {
+		if (read){
+			entry->reads++;
+			entry->readBlocks.set(block);
+		} else {
+			entry->writes++;
+			entry->writtenBlocks.set(block);
+		}
+	}
+}
+
+void SketchAccessMonitor::readCounts(vector<CountEntry> *counts){
+	fill(readSketch.begin(), readSketch.end(), 0);
+	fill(writeSketch.begin(), writeSketch.end(), 0);
+	BaseAccessMonitor::readCounts(counts);
+}
+
+
+CamAccessMonitor::CamAccessMonitor(const string& nameArg, const string& descArg, StatContainer *statCont, unsigned numEntriesArg) :
+	BaseAccessMonitor(nameArg, descArg, statCont),
+	numEntries(numEntriesArg),
+	links(numEntriesArg),
+	buckets(numEntriesArg + 1), //an access allocates the bucket of the next count before it frees the current one
+	firstBucket(NIL),
+	replacements(statCont, nameArg + "_replacements", "Number of entries replaced in the " + descArg, 0) {
+	if (numEntries == 0){
+		error("Number of monitor CAM entries must be larger than 0");
+	}
+	clearBuckets();
+}
+
+uint32 CamAccessMonitor::allocateBucket(uint64 count, uint32 prev, uint32 next){
+	assert(!freeBuckets.empty());
+	uint32 bucket = freeBuckets.back();
+	freeBuckets.pop_back();
+	CountBucket *b = &buckets[bucket];
+	b->count = count;
+	b->head = NIL;
+	b->tail = NIL;
+	b->prev = prev;
+	b->next = next;
+	if (prev == NIL){
+		firstBucket = bucket;
+	} else {
+		buckets[prev].next = bucket;
+	}
+	if (next != NIL){
+		buckets[next].prev = bucket;
+	}
+	return bucket;
+}
+
+/*
+ * Appends the entry at pos to the list of the bucket
+ */
+void CamAccessMonitor::link(uint32 pos, uint32 bucket){
+	CountLink *l = &links[pos];
+	CountBucket *b = &buckets[bucket];
+	l->bucket = bucket;
+	l->prev = b->tail;
+	l->next = NIL;
+	if (b->tail == NIL){
+		b->head = pos;
+	} else {
+		links[b->tail].next = pos;
+	}
+	b->tail = pos;
+}
+
+/*
+ * Removes the entry at pos from the list of its bucket and frees the bucket if it becomes empty
+ */
+void CamAccessMonitor::unlink(uint32 pos){
+	CountLink *l = &links[pos];
+	CountBucket *b = &buckets[l->bucket];
+	if (l->prev == NIL){
+		b->head = l->next;
+	} else {
+		links[l->prev].next = l->next;
+	}
+	if (l->next == NIL){
+		b->tail = l->prev;
+	} else {
+		links[l->next].prev = l->prev;
+	}
+	if (b->head == NIL){
+		if (b->prev == NIL){
+			firstBucket = b->next;
+		} else {
+			buckets[b->prev].next = b->next;
+		}
+		if (b->next != NIL){
+			buckets[b->next].prev = b->prev;
+		}
+		freeBuckets.push_back(l->bucket);
+	}
+}
+
+void CamAccessMonitor::clearBuckets(){
+	firstBucket = NIL;
+	freeBuckets.clear();
+	for (uint32 i = 0; i < buckets.size(); i++){
+		freeBuckets.push_back(i);
+	}
+}
+
+void CamAccessMonitor::access(addrint page, unsigned block, bool read){
+	CountEntry *entry = table.find(page);
+	if (entry == 0){
+		uint32 pos;
+		if (table.size() < numEntries){
+			pos = table.size();
+			entry = table.insert(page);
+		} else {
+			pos = buckets[firstBucket].head;
+			unlink(pos);
+			entry = table.replace(pos, page);
+			replacements++;
+		}
+		//the entry starts with this access
+		if (firstBucket == NIL || buckets[firstBucket].count != 1){
+			link(pos, allocateBucket(1, NIL, firstBucket));
+		} else {
+			link(pos, firstBucket);
+		}
+	} else {
+		uint32 pos = table.position(entry);
+		uint32 bucket = links[pos].bucket;
+		uint64 count = buckets[bucket].count + 1;
+		uint32 next = buckets[bucket].next;
+		if (next == NIL || buckets[next].count != count){
+			next = allocateBucket(count, bucket, next);
+		}
+		unlink(pos);
+		link(pos, next);
+	}
+	if (read){
+		entry->reads++;
+		entry->readBlocks.set(block);
+	} else {
+		entry->writes++;
+		entry->writtenBlocks.set(block);
+	}
+	updates++;
+}
+
+void CamAccessMonitor::readCounts(vector<CountEntry> *counts){
+	BaseAccessMonitor::readCounts(counts);
+	clearBuckets();
+}
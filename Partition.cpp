@@ -6,6 +6,7 @@
 
 #include "Partition.H"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
@@ -330,3 +331,97 @@ void DynamicPartition::calculate(uint64 cycles, vector<Counter *>& instrCounters
 
 
 
+
+
+UtilityPartition::UtilityPartition(unsigned numPoliciesArg, unsigned pageSizeArg, uint64 dramSizeArg, string dramFractionsArg, string rateFractionsArg, unsigned numUnitsArg, uint64 sampledSetsArg) : numPolicies(numPoliciesArg), numUnits(numUnitsArg) {
+	//start from the static partition given by the fractions, whose total number of DRAM pages is then repartitioned
+	StaticPartition initial(numPolicies, pageSizeArg, dramSizeArg, dramFractionsArg, rateFractionsArg);
+	dramPages = 0;
+	for (unsigned i = 0; i < numPolicies; i++){
+		dramPagesPerPid.emplace_back(initial.getDramPages(i));
+		ratePerPid.emplace_back(initial.getRate(i));
+		dramPages += initial.getDramPages(i);
+	}
+
+	if (numUnits < numPolicies){
+		error("The number of allocation units (%u) must be at least the number of policies (%u)", numUnits, numPolicies);
+	}
+	unitPages = dramPages / numUnits;
+	if (unitPages == 0){
+		error("The number of allocation units (%u) is larger than the number of DRAM pages (%lu)", numUnits, dramPages);
+	}
+	if (sampledSetsArg == 0){
+		error("The number of sampled sets must be greater than 0");
+	}
+	sampledSets = min(sampledSetsArg, unitPages);
+
+	stacks.resize(numPolicies, vector<vector<addrint> >(sampledSets));
+	hits.resize(numPolicies, vector<uint64>(numUnits, 0));
+}
+
+void UtilityPartition::monitor(int pid, addrint page) {
+	uint64 set = (page * 0x9E3779B97F4A7C15ULL) % unitPages;
+	if (set >= sampledSets){
+		return;
+	}
+	vector<addrint>& stack = stacks[pid][set];
+	unsigned pos = 0;
+	while (pos < stack.size() && stack[pos] != page){
+		pos++;
+	}
+	if (pos == stack.size()){
+		if (stack.size() < numUnits){
+			stack.emplace_back(page);
+		}
+		pos = stack.size() - 1;
+	} else {
+		hits[pid][pos]++;
+	}
+	for (unsigned i = pos; i > 0; i--){
+		stack[i] = stack[i - 1];
+	}
+	stack[0] = page;
+}
+
+/*
+ * Lookahead algorithm: every policy gets one unit, and then the policy with the highest marginal utility (hits per unit) over any number
+ * of additional units gets that number of units, until all units are allocated. Units that no policy has any use for are split evenly.
+ */
+void UtilityPartition::calculate(uint64 cycles, vector<Counter *>& instrCounters) {
+	vector<unsigned> units(numPolicies, 1);
+	unsigned balance = numUnits - numPolicies;
+	while (balance > 0){
+		unsigned bestPid = 0;
+		unsigned bestUnits = 0;
+		double bestUtility = 0.0;
+		for (unsigned i = 0; i < numPolicies; i++){
+			uint64 gain = 0;
+			for (unsigned k = 1; k <= balance; k++){
+				gain += hits[i][units[i] + k - 1];
+				double utility = static_cast<double>(gain) / k;
+				if (utility > bestUtility){
+					bestUtility = utility;
+					bestPid = i;
+					bestUnits = k;
+				}
+			}
+		}
+		if (bestUnits == 0){
+			for (unsigned i = 0; balance > 0; i = (i + 1) % numPolicies){
+				units[i]++;
+				balance--;
+			}
+		} else {
+			units[bestPid] += bestUnits;
+			balance -= bestUnits;
+		}
+	}
+
+	for (unsigned i = 0; i < numPolicies; i++){
+		dramPagesPerPid[i] = units[i] * unitPages;
+		for (unsigned j = 0; j < numUnits; j++){
+			hits[i][j] /= 2;
+		}
+	}
+	dramPagesPerPid[0] += dramPages - numUnits * unitPages;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+#include "Profiler.H"
+#include "Error.H"
+
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <map>
+
+Profiler::Profiler(uint64 samplePeriodArg) :
+		samplePeriod(samplePeriodArg),
+		countdown(samplePeriodArg),
+		randomState(0x9E3779B97F4A7C15ULL),
+		sampling(false),
+		excluded(0),
+		lastHandler(0),
+		lastEntry(0),
+		startCycles(0),
+		stopCycles(0) {
+	if (samplePeriod == 0){
+		error("The profiler sample period must be greater than 0");
+	}
+}
+
+void Profiler::addScope(const char *name, uint64 cycles){
+	excluded += cycles;
+	for (vector<pair<const char *, Entry> >::iterator it = scopes.begin(); it != scopes.end(); ++it){
+		if (strcmp(it->first, name) == 0){
+			it->second.sampledEvents++;
+			it->second.cycles += cycles;
+			return;
+		}
+	}
+	scopes.emplace_back(name, Entry());
+	scopes.back().second.sampledEvents = 1;
+	scopes.back().second.cycles = cycles;
+}
+
+/*
+ * Prints one line per class of handler (and per scope) with the estimated cycles, sorted by decreasing cycles. The lines
+ * start with # so that the table can follow the statistics in the same file.
+ */
+void Profiler::print(ostream& os) const {
+	struct Row {
+		string name;
+		uint64 instances;
+		uint64 events;
+		double cycles;
+	};
+	map<string, Row> classes;
+	for (unordered_map<IEventHandler *, Entry>::const_iterator it = handlers.begin(); it != handlers.end(); ++it){
+		const char *mangled = it->second.type->name();
+		int status;
+		char *demangled = abi::__cxa_demangle(mangled, 0, 0, &status);
+		string name(status == 0 ? demangled : mangled);
+		free(demangled);
+		Row& row = classes.emplace(name, Row{name, 0, 0, 0}).first->second;
+		row.instances++;
+		row.events += it->second.sampledEvents * samplePeriod;
+		row.cycles += static_cast<double>(it->second.cycles) * samplePeriod;
+	}
+	vector<Row> rows;
+	for (map<string, Row>::const_iterator it = classes.begin(); it != classes.end(); ++it){
+		rows.emplace_back(it->second);
+	}
+	for (vector<pair<const char *, Entry> >::const_iterator it = scopes.begin(); it != scopes.end(); ++it){
+		rows.push_back(Row{string("(") + it->first + ")", 0, it->second.sampledEvents * samplePeriod, static_cast<double>(it->second.cycles) * samplePeriod});
+	}
+	sort(rows.begin(), rows.end(), [](const Row& a, const Row& b){return a.cycles > b.cycles;});
+
+	double attributed = 0;
+	for (vector<Row>::const_iterator it = rows.begin(); it != rows.end(); ++it){
+		attributed += it->cycles;
+	}
+	//timing an event slows it down a little, so the estimates can add up to more than the measured time of the run
+	double other = stopCycles - startCycles > attributed ? stopCycles - startCycles - attributed : 0;
+	double total = attributed + other;
+
+	os << "#Profile of host cycles per event handler class (events and cycles estimated from one in " << samplePeriod << " events)" << endl;
+	os << "#" << setw(40) << left << "handler" << right << setw(10) << "instances" << setw(16) << "events" << setw(18) << "cycles" << setw(10) << "percent" << setw(14) << "cycles/event" << endl;
+	ios::fmtflags flags = os.flags();
+	streamsize precision = os.precision();
+	os.setf(ios::fixed);
+	os.precision(2);
+	for (vector<Row>::const_iterator it = rows.begin(); it != rows.end(); ++it){
+		os << "#" << setw(40) << left << it->name << right << setw(10) << it->instances << setw(16) << it->events << setw(18) << static_cast<uint64>(it->cycles);
+		os << setw(10) << (total == 0 ? 0 : 100 * it->cycles / total) << setw(14) << (it->events == 0 ? 0 : it->cycles / it->events) << endl;
+	}
+	os << "#" << setw(40) << left << "(engine and unattributed)" << right << setw(10) << "" << setw(16) << "" << setw(18) << static_cast<uint64>(other);
+	os << setw(10) << (total == 0 ? 0 : 100 * other / total) << endl;
+	os.flags(flags);
+	os.precision(precision);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+#include "Sampler.H"
+#include "Error.H"
+
+#include <cmath>
+#include <limits>
+
+void RunningMean::add(double value){
+	count++;
+	double delta = value - mean;
+	mean += delta / count;
+	m2 += delta * (value - mean);
+}
+
+double RunningMean::getRelativeError(double z) const {
+	if (count < 2 || mean == 0.0){
+		return numeric_limits<double>::infinity();
+	}
+	return z * sqrt(getVariance() / count) / mean;
+}
+
+Sampler::Sampler(
+		Engine *engineArg,
+		const string& nameArg,
+		const string& descArg,
+		StatContainer *statCont,
+		uint64 functionalLengthArg,
+		uint64 detailedWarmupLengthArg,
+		uint64 windowLengthArg,
+		double targetErrorArg,
+		double confidenceArg,
+		unsigned minWindowsArg) :
+				engine(engineArg),
+				name(nameArg),
+				desc(descArg),
+				functionalLength(functionalLengthArg),
+				detailedWarmupLength(detailedWarmupLengthArg),
+				windowLength(windowLengthArg),
+				targetError(targetErrorArg),
+				minWindows(minWindowsArg),
+				windowStart(0),
+				windowLatency(0),
+				windowRequests(0),
+				windows(statCont, nameArg + "_sampling_windows", "Number of " + descArg + " sampling windows measured", 0),
+				functionalInstructions(statCont, nameArg + "_sampling_functional_instructions", "Number of " + descArg + " instructions used for functional warmup between sampling windows", 0),
+				ipcMean(statCont, nameArg + "_sampling_ipc", "Mean " + descArg + " IPC of the sampling windows", this, &Sampler::getIpcMean),
+				ipcError(statCont, nameArg + "_sampling_ipc_error", "Half width of the confidence interval of the sampled " + descArg + " IPC relative to its mean", this, &Sampler::getIpcError),
+				latencyMean(statCont, nameArg + "_sampling_data_read_latency", "Mean " + descArg + " data read latency of the sampling windows", this, &Sampler::getLatencyMean),
+				latencyError(statCont, nameArg + "_sampling_data_read_latency_error", "Half width of the confidence interval of the sampled " + descArg + " data read latency relative to its mean", this, &Sampler::getLatencyError) {
+
+	if (windowLength == 0){
+		error("The length of the sampling windows must be greater than 0");
+	}
+	if (confidenceArg <= 0.0 || confidenceArg >= 1.0){
+		error("The confidence level must be between 0 and 1");
+	}
+	//z such that a standard normal variable is within [-z, z] with the given probability
+	double low = 0.0, high = 10.0;
+	for (unsigned i = 0; i < 100; i++){
+		double mid = (low + high) / 2;
+		if (erf(mid / sqrt(2.0)) < confidenceArg){
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+	z = (low + high) / 2;
+
+	startDetailed();
+}
+
+void Sampler::processInterrupt(Counter *counterArg){
+	if (phase == DETAILED_WARMUP){
+		startMeasurement();
+	} else if (phase == MEASUREMENT){
+		endMeasurement();
+	} else {
+		myassert(false);
+	}
+}
+
+void Sampler::startDetailed(){
+	counter.reset();
+	if (detailedWarmupLength == 0){
+		startMeasurement();
+	} else {
+		phase = DETAILED_WARMUP;
+		counter.setInterrupt(detailedWarmupLength, this);
+	}
+}
+
+void Sampler::addLatency(uint64 latency){
+	if (phase == MEASUREMENT){
+		windowLatency += latency;
+		windowRequests++;
+	}
+}
+
+void Sampler::startMeasurement(){
+	phase = MEASUREMENT;
+	windowStart = engine->getTimestamp();
+	windowLatency = 0;
+	windowRequests = 0;
+	counter.setInterrupt(detailedWarmupLength + windowLength, this);
+}
+
+void Sampler::endMeasurement(){
+	uint64 cycles = engine->getTimestamp() - windowStart;
+	cpis.add(static_cast<double>(cycles) / windowLength);
+	if (windowRequests != 0){
+		latencies.add(static_cast<double>(windowLatency) / windowRequests);
+	}
+	windows++;
+	counter.setInterrupt(0, 0);
+	if (cpis.getCount() >= minWindows && cpis.getRelativeError(z) <= targetError){
+		phase = DONE;
+	} else {
+		phase = FUNCTIONAL_WARMUP;
+	}
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+#include "SimPoint.H"
+#include "Error.H"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+
+void SimPointFile::read(const string& filename){
+	ifstream in(filename.c_str());
+	if (!in.is_open()){
+		error("Could not open simulation points file '%s'", filename.c_str());
+	}
+	period = 0;
+	numIntervals = 0;
+	points.clear();
+	string line;
+	while (getline(in, line)){
+		if (line.empty()){
+			continue;
+		}
+		istringstream iss(line);
+		if (line[0] == '#'){
+			string hash, key;
+			uint64 value;
+			if (iss >> hash >> key >> value){
+				if (key == "period"){
+					period = value;
+				} else if (key == "intervals"){
+					numIntervals = value;
+				}
+			}
+		} else {
+			uint64 interval;
+			double weight;
+			if (!(iss >> interval >> weight)){
+				error("Invalid line in simulation points file '%s': %s", filename.c_str(), line.c_str());
+			}
+			points.emplace_back(interval, weight);
+		}
+	}
+	if (period == 0 || numIntervals == 0){
+		error("Simulation points file '%s' does not specify the period and the number of intervals", filename.c_str());
+	}
+}
+
+void SimPointFile::write(const string& filename) const {
+	ofstream out(filename.c_str());
+	if (!out.is_open()){
+		error("Could not open simulation points file '%s'", filename.c_str());
+	}
+	out << "# period " << period << endl;
+	out << "# intervals " << numIntervals << endl;
+	for (auto it = points.begin(); it != points.end(); ++it){
+		out << it->interval << " " << it->weight << endl;
+	}
+}
+
+
+SimPointAnalyzer::SimPointAnalyzer(unsigned dimensionsArg, uint64 seedArg) : dimensions(dimensionsArg), seed(seedArg), accesses(0) {
+	if (dimensions == 0){
+		error("The number of dimensions must be greater than 0");
+	}
+}
+
+void SimPointAnalyzer::access(addrint page, bool instr){
+	counts[(page << 1) | (instr ? 1 : 0)]++;
+	accesses++;
+}
+
+void SimPointAnalyzer::endInterval(){
+	vectors.emplace_back(dimensions, 0.0);
+	vector<double>& vec = vectors.back();
+	if (accesses != 0){
+		for (auto it = counts.begin(); it != counts.end(); ++it){
+			double frequency = static_cast<double>(it->second) / accesses;
+			for (unsigned d = 0; d < dimensions; d++){
+				vec[d] += frequency * project(it->first, d);
+			}
+		}
+	}
+	counts.clear();
+	accesses = 0;
+}
+
+/*
+ * Returns a pseudorandom value in [-1, 1) that only depends on the key, the dimension and the seed
+ */
+double SimPointAnalyzer::project(addrint key, unsigned dimension) const {
+	uint64 x = key ^ (seed + 0x9E3779B97F4A7C15ULL * (dimension + 1));
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	x = x ^ (x >> 31);
+	return static_cast<double>(x >> 11) / static_cast<double>(1ULL << 52) - 1.0;
+}
+
+static double squaredDistance(const vector<double>& a, const vector<double>& b){
+	double sum = 0.0;
+	for (unsigned i = 0; i < a.size(); i++){
+		double diff = a[i] - b[i];
+		sum += diff * diff;
+	}
+	return sum;
+}
+
+/*
+ * k-means with k-means++ seeding. The representative of each cluster is the interval closest to its centroid
+ */
+void SimPointAnalyzer::cluster(unsigned maxClusters, unsigned maxIterations, vector<SimPoint> *points) const {
+	uint64 n = vectors.size();
+	if (n == 0){
+		error("There are no complete intervals to cluster");
+	}
+	if (maxClusters == 0 || maxIterations == 0){
+		error("The number of clusters and the number of iterations must be greater than 0");
+	}
+	unsigned k = min<uint64>(maxClusters, n);
+	mt19937_64 rng(seed);
+
+	vector<vector<double> > centroids;
+	centroids.emplace_back(vectors[rng() % n]);
+	vector<double> minDistances(n, numeric_limits<double>::max());
+	while (centroids.size() < k){
+		double total = 0.0;
+		for (uint64 i = 0; i < n; i++){
+			minDistances[i] = min(minDistances[i], squaredDistance(vectors[i], centroids.back()));
+			total += minDistances[i];
+		}
+		if (total == 0.0){
+			//all the intervals are already covered by a centroid
+			break;
+		}
+		double target = uniform_real_distribution<double>(0.0, total)(rng);
+		uint64 next = 0;
+		for (double sum = minDistances[0]; sum < target && next + 1 < n; sum += minDistances[next]){
+			next++;
+		}
+		centroids.emplace_back(vectors[next]);
+	}
+	k = centroids.size();
+
+	vector<unsigned> assignments(n, k);
+	vector<uint64> sizes(k);
+	for (unsigned iter = 0; iter < maxIterations; iter++){
+		bool changed = false;
+		for (uint64 i = 0; i < n; i++){
+			unsigned best = 0;
+			double bestDistance = numeric_limits<double>::max();
+			for (unsigned c = 0; c < k; c++){
+				double distance = squaredDistance(vectors[i], centroids[c]);
+				if (distance < bestDistance){
+					best = c;
+					bestDistance = distance;
+				}
+			}
+			if (assignments[i] != best){
+				assignments[i] = best;
+				changed = true;
+			}
+		}
+		if (!changed){
+			break;
+		}
+		fill(sizes.begin(), sizes.end(), 0);
+		for (unsigned c = 0; c < k; c++){
+			fill(centroids[c].begin(), centroids[c].end(), 0.0);
+		}
+		for (uint64 i = 0; i < n; i++){
+			sizes[assignments[i]]++;
+			for (unsigned d = 0; d < dimensions; d++){
+				centroids[assignments[i]][d] += vectors[i][d];
+			}
+		}
+		for (unsigned c = 0; c < k; c++){
+			if (sizes[c] != 0){
+				for (unsigned d = 0; d < dimensions; d++){
+					centroids[c][d] /= sizes[c];
+				}
+			}
+		}
+	}
+
+	fill(sizes.begin(), sizes.end(), 0);
+	vector<uint64> representatives(k, n);
+	vector<double> representativeDistances(k, numeric_limits<double>::max());
+	for (uint64 i = 0; i < n; i++){
+		unsigned c = assignments[i];
+		sizes[c]++;
+		double distance = squaredDistance(vectors[i], centroids[c]);
+		if (distance < representativeDistances[c]){
+			representatives[c] = i;
+			representativeDistances[c] = distance;
+		}
+	}
+	points->clear();
+	for (unsigned c = 0; c < k; c++){
+		if (sizes[c] != 0){
+			points->emplace_back(representatives[c], static_cast<double>(sizes[c]) / n);
+		}
+	}
+	sort(points->begin(), points->end(), [](const SimPoint& a, const SimPoint& b){return a.interval < b.interval;});
+}
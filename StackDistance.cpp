@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+#include "StackDistance.H"
+#include "Error.H"
+
+#include <algorithm>
+#include <limits>
+
+#define SAMPLING_HASH_BITS 24
+#define INITIAL_CAPACITY (1 << 16)
+
+StackDistance::StackDistance(double rateArg) : rate(rateArg), time(0), accesses(0), coldMisses(0), histogram(65) {
+	if (rate <= 0.0 || rate > 1.0){
+		error("The sampling rate must be greater than 0 and not greater than 1");
+	}
+	threshold = static_cast<uint64>(rate * (1ULL << SAMPLING_HASH_BITS));
+	tree.resize(INITIAL_CAPACITY + 1);
+}
+
+void StackDistance::access(addrint block){
+	if (rate < 1.0){
+		uint64 hash = block * 0x9E3779B97F4A7C15ULL;
+		if ((hash >> (64 - SAMPLING_HASH_BITS)) >= threshold){
+			return;
+		}
+	}
+	accesses++;
+	if (time + 1 == tree.size()){
+		compact();
+	}
+	auto it = lastAccess.find(block);
+	if (it == lastAccess.end()){
+		coldMisses++;
+		lastAccess.emplace(block, time);
+	} else {
+		uint64 distance = static_cast<uint64>((sum(time - 1) - sum(it->second)) / rate);
+		unsigned bucket = 0;
+		while (distance != 0){
+			bucket++;
+			distance >>= 1;
+		}
+		histogram[bucket]++;
+		add(it->second, -1);
+		it->second = time;
+	}
+	add(time, 1);
+	time++;
+}
+
+double StackDistance::getMissRatio(uint64 numBlocks) const {
+	if (accesses == 0){
+		return 0.0;
+	}
+	unsigned k = 0;
+	while ((1ULL << k) < numBlocks){
+		k++;
+	}
+	uint64 misses = coldMisses;
+	for (unsigned i = k + 1; i < histogram.size(); i++){
+		misses += histogram[i];
+	}
+	return static_cast<double>(misses) / accesses;
+}
+
+void StackDistance::add(uint64 index, int32 value){
+	for (uint64 i = index + 1; i < tree.size(); i += i & -i){
+		tree[i] += value;
+	}
+}
+
+uint64 StackDistance::sum(uint64 index) const {
+	uint64 total = 0;
+	for (uint64 i = index + 1; i > 0; i -= i & -i){
+		total += tree[i];
+	}
+	return total;
+}
+
+/*
+ * Renumbers the access times of the blocks to 0..n-1 (keeping their order) so that the tree does not grow with the length of the trace
+ */
+void StackDistance::compact(){
+	vector<pair<uint64, addrint> > live;
+	live.reserve(lastAccess.size());
+	for (auto it = lastAccess.begin(); it != lastAccess.end(); ++it){
+		live.emplace_back(it->second, it->first);
+	}
+	sort(live.begin(), live.end());
+	uint64 capacity = max<uint64>(2 * live.size(), INITIAL_CAPACITY);
+	tree.assign(capacity + 1, 0);
+	for (uint64 i = 0; i < live.size(); i++){
+		lastAccess[live[i].second] = i;
+		add(i, 1);
+	}
+	time = live.size();
+}
+
+
+SetStackDistance::SetStackDistance(uint64 numSetsArg, unsigned depthArg) : numSets(numSetsArg), depth(depthArg), accesses(0), histogram(depthArg + 1) {
+	if (numSets == 0 || (numSets & (numSets - 1)) != 0){
+		error("The number of sets must be a power of 2");
+	}
+	stacks.resize(numSets * depth, numeric_limits<addrint>::max());
+}
+
+void SetStackDistance::access(addrint block){
+	accesses++;
+	addrint *stack = &stacks[(block & (numSets - 1)) * depth];
+	unsigned pos = 0;
+	while (pos < depth && stack[pos] != block){
+		pos++;
+	}
+	histogram[pos]++;
+	if (pos == depth){
+		pos--;
+	}
+	for (unsigned i = pos; i > 0; i--){
+		stack[i] = stack[i - 1];
+	}
+	stack[0] = block;
+}
+
+double SetStackDistance::getMissRatio(unsigned assoc) const {
+	if (accesses == 0){
+		return 0.0;
+	}
+	uint64 misses = 0;
+	for (unsigned i = assoc; i <= depth; i++){
+		misses += histogram[i];
+	}
+	return static_cast<double>(misses) / accesses;
+}
@@ -7,19 +7,17 @@
 #include "Statistics.H"
 #include "Error.H"
 
+#include <zlib.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstring>
 
 void StatContainer::insert(StatBase *stat){
 	//cout << "insert: " << stat->getName() << endl;
-	if (stat->getName().find_first_of(" \t\n\r") != string::npos){
-		error("Statistic %s contains a whitespace in its name", stat->getName().c_str());
-	}
-	for (list<StatBase*>::iterator it = stats.begin(); it != stats.end(); ++it){
-		if ((*it)->getName() == stat->getName()){
-			error("Statistic %s has already been defined", stat->getName().c_str());
-		}
-	}
-	stats.emplace_back(stat);
+	checkName(stat->getName());
+	index.emplace(stat->getName(), stats.insert(stats.end(), stat));
 }
 
 /*
@@ -27,26 +25,47 @@ void StatContainer::insert(StatBase *stat){
  */
 StatListIter StatContainer::insertAfter(StatBase *stat, StatListIter parent){
 	//cout << "insertAfter: " << stat->getName() << ", " << (*parent)->getName() << endl;
-	if (stat->getName().find_first_of(" \t\n\r") != string::npos){
-		error("Statistic %s contains a whitespace in its name", stat->getName().c_str());
-	}
-	for (list<StatBase*>::iterator it = stats.begin(); it != stats.end(); ++it){
-		//cout << "insertAfter: " << (*it)->getName() << endl;
-		if ((*it)->getName() == stat->getName()){
-			error("Statistic %s has already been defined", stat->getName().c_str());
-		}
-	}
+	checkName(stat->getName());
 
 	assert(parent != stats.end());
 
 	++parent;
-	return stats.insert(parent, stat);
+	StatListIter it = stats.insert(parent, stat);
+	index.emplace(stat->getName(), it);
+	return it;
 }
 
 StatListIter StatContainer::erase(StatListIter iter){
+	index.erase((*iter)->getName());
 	return stats.erase(iter);
 }
 
+void StatContainer::checkName(const string& name) const {
+	if (name.find_first_of(" \t\n\r") != string::npos){
+		error("Statistic %s contains a whitespace in its name", name.c_str());
+	}
+	if (index.count(name) != 0){
+		error("Statistic %s has already been defined", name.c_str());
+	}
+}
+
+StatBase *StatContainer::find(const string& name) const {
+	unordered_map<string, StatListIter>::const_iterator it = index.find(name);
+	return it == index.end() ? 0 : *it->second;
+}
+
+/*
+ * Statistics of a component share the name of the component as a prefix (e.g., dram_bank_3_ for the statistics of bank 3 of the DRAM)
+ */
+void StatContainer::findPrefix(const string& prefix, vector<StatBase*> *found) const {
+	found->clear();
+	for (list<StatBase*>::const_iterator it = stats.begin(); it != stats.end(); ++it){
+		if ((*it)->getName().compare(0, prefix.size(), prefix) == 0){
+			found->emplace_back(*it);
+		}
+	}
+}
+
 void StatContainer::reset(){
 	for (list<StatBase*>::iterator it = stats.begin(); it != stats.end(); ++it){
 		(*it)->reset();
@@ -54,6 +73,10 @@ void StatContainer::reset(){
 }
 
 void StatContainer::startInterval(){
+	for (uint64 c = 0; c < chunks.size(); c++){
+		uint64 used = c + 1 == chunks.size() ? numSlots - c * SLOTS_PER_CHUNK : SLOTS_PER_CHUNK;
+		memcpy(&chunks[c][SLOTS_PER_CHUNK], &chunks[c][0], used * sizeof(uint64));
+	}
 	for (list<StatBase*>::iterator it = stats.begin(); it != stats.end(); ++it){
 		(*it)->startInterval();
 	}
@@ -66,23 +89,321 @@ void StatContainer::genListStats(){
 }
 
 void StatContainer::print(ostream& os) {
+	beginEvaluation();
 	for (list<StatBase*>::const_iterator it = stats.begin(); it != stats.end(); ++it){
 		os << "#" << (*it)->getDesc() << endl;
+		string formula = (*it)->getFormula();
+		if (!formula.empty()){
+			os << "#=" << formula << endl;
+		}
 		os << (*it)->getName() << " " << (*it)->getValueAsString() << endl << endl;
 	}
+	endEvaluation();
 }
 
 void StatContainer::printNames(ostream& os) {
 	for (list<StatBase*>::const_iterator it = stats.begin(); it != stats.end(); ++it){
-		os << (*it)->getName() << '\t' << flush;
+		os << (*it)->getName() << '\t';
 	}
 }
 
 void StatContainer::printInterval(ostream& os) {
+	beginEvaluation();
 	for (list<StatBase*>::const_iterator it = stats.begin(); it != stats.end(); ++it){
 		//os << (*it)->getName() << " " << (*it)->getIntervalValueAsString() << endl;
 		(*it)->printIntervalValue(os);
-		os << '\t' << flush;
+		os << '\t';
+	}
+	endEvaluation();
+}
+
+void StatContainer::writeNames(IntervalStatsWriter *writer) {
+	for (list<StatBase*>::const_iterator it = stats.begin(); it != stats.end(); ++it){
+		writer->addColumn((*it)->getName(), (*it)->getType());
+	}
+	writer->writeHeader();
+}
+
+void StatContainer::writeInterval(IntervalStatsWriter *writer) {
+	beginEvaluation();
+	unsigned column = 0;
+	for (list<StatBase*>::const_iterator it = stats.begin(); it != stats.end(); ++it){
+		(*it)->copyIntervalValue(writer->getCell(column));
+		column++;
+	}
+	endEvaluation();
+	writer->finishRow();
+}
+
+
+/*
+ * Statistics are saved by name, so that a checkpoint can be restored into a configuration with a different set of statistics
+ */
+void StatContainer::saveCheckpoint(CheckpointWriter *cp){
+	vector<pair<const StatBase*, string> > states;
+	for (list<StatBase*>::const_iterator it = stats.begin(); it != stats.end(); ++it){
+		CheckpointWriter statCp;
+		if ((*it)->saveCheckpoint(&statCp)){
+			states.emplace_back(*it, statCp.getBuffer());
+		}
+	}
+	cp->write<uint64>(states.size());
+	for (auto it = states.begin(); it != states.end(); ++it){
+		cp->writeString(it->first->getName());
+		cp->writeString(it->second);
+	}
+}
+
+bool StatContainer::restoreCheckpoint(CheckpointReader *cp){
+	uint64 numStates = cp->read<uint64>();
+	for (uint64 i = 0; i < numStates; i++){
+		string name, state;
+		cp->readString(&name);
+		cp->readString(&state);
+		StatBase *stat = find(name);
+		if (stat != 0){
+			CheckpointReader statCp(name, state);
+			stat->restoreCheckpoint(&statCp);
+			if (!statCp.done()){
+				error("Checkpoint state of statistic %s does not match its type", name.c_str());
+			}
+		}
+	}
+	return true;
+}
+
+
+HistogramStat::HistogramStat(StatContainer *cont, const string& name, const string& desc) :
+		StatTemplateBase<uint64>(name + "_samples", desc + " (number of samples)"),
+		counts(NUM_BUCKETS, 0),
+		intervalCounts(NUM_BUCKETS, 0),
+		samples(0),
+		intervalSamples(0) {
+	cont->insert(this);
+	const char *suffixes[] = {"p50", "p95", "p99", "p999"};
+	const char *descs[] = {"50th", "95th", "99th", "99.9th"};
+	double fractions[] = {0.5, 0.95, 0.99, 0.999};
+	for (unsigned i = 0; i < sizeof(fractions) / sizeof(fractions[0]); i++){
+		percentiles.emplace_back(new PercentileStat(cont, name + "_" + suffixes[i], desc + " (" + descs[i] + " percentile)", this, fractions[i]));
+	}
+}
+
+HistogramStat::~HistogramStat(){
+	for (vector<PercentileStat *>::iterator it = percentiles.begin(); it != percentiles.end(); ++it){
+		delete *it;
+	}
+}
+
+uint64 HistogramStat::getBucketMax(unsigned bucket){
+	if (bucket < 2 * SUB_BUCKETS){
+		return bucket;
+	}
+	unsigned shift = (bucket >> SUB_BUCKET_BITS) - 1;
+	uint64 top = (bucket & (SUB_BUCKETS - 1)) + SUB_BUCKETS;
+	return ((top + 1) << shift) - 1;
+}
+
+uint64 HistogramStat::getPercentile(double fraction, bool interval) const {
+	uint64 total = interval ? samples - intervalSamples : samples;
+	if (total == 0){
+		return 0;
+	}
+	uint64 target = max<uint64>(static_cast<uint64>(ceil(fraction * total)), 1);
+	uint64 count = 0;
+	for (unsigned i = 0; i < NUM_BUCKETS; i++){
+		count += interval ? counts[i] - intervalCounts[i] : counts[i];
+		if (count >= target){
+			return getBucketMax(i);
+		}
+	}
+	return getBucketMax(NUM_BUCKETS - 1);
+}
+
+void HistogramStat::reset(){
+	fill(counts.begin(), counts.end(), 0);
+	fill(intervalCounts.begin(), intervalCounts.end(), 0);
+	samples = intervalSamples = 0;
+}
+
+void HistogramStat::startInterval(){
+	intervalCounts = counts;
+	intervalSamples = samples;
+}
+
+bool HistogramStat::saveCheckpoint(CheckpointWriter *cp) const {
+	cp->write(samples);
+	cp->write(intervalSamples);
+	cp->writeVector(counts);
+	cp->writeVector(intervalCounts);
+	return true;
+}
+
+void HistogramStat::restoreCheckpoint(CheckpointReader *cp){
+	cp->read(&samples);
+	cp->read(&intervalSamples);
+	cp->readVector(&counts);
+	cp->readVector(&intervalCounts);
+	if (counts.size() != NUM_BUCKETS || intervalCounts.size() != NUM_BUCKETS){
+		error("Histogram %s in checkpoint has a different number of buckets", _name.c_str());
+	}
+}
+
+
+#define INTERVAL_STATS_MAGIC "HMMISTB1"
+#define INTERVAL_STATS_COMPRESSED 1
+
+IntervalStatsWriter::IntervalStatsWriter(const string& fileNameArg, bool compressArg, uint64 rowsPerGroupArg) :
+		fileName(fileNameArg),
+		compress(compressArg),
+		rowsPerGroup(rowsPerGroupArg),
+		numRows(0),
+		headerWritten(false) {
+	file.open(fileName.c_str(), ios::binary);
+	if (!file.is_open()){
+		error("Could not open statistics file '%s'", fileName.c_str());
+	}
+}
+
+IntervalStatsWriter::~IntervalStatsWriter(){
+	close();
+}
+
+void IntervalStatsWriter::addColumn(const string& name, StatType type){
+	if (headerWritten){
+		error("Cannot add column %s to statistics file '%s' after the first row", name.c_str(), fileName.c_str());
+	}
+	columns.emplace_back(name, type);
+}
+
+void IntervalStatsWriter::finishRow(){
+	numRows++;
+	if (numRows == rowsPerGroup){
+		writeGroup();
+	}
+}
+
+void IntervalStatsWriter::close(){
+	if (file.is_open()){
+		if (!headerWritten){
+			writeHeader();
+		}
+		if (numRows != 0){
+			writeGroup();
+		}
+		file.close();
+		if (file.fail()){
+			error("Error writing statistics file '%s'", fileName.c_str());
+		}
+	}
+}
+
+void IntervalStatsWriter::writeHeader(){
+	string header(INTERVAL_STATS_MAGIC);
+	uint32 numColumns = columns.size();
+	uint32 flags = compress ? INTERVAL_STATS_COMPRESSED : 0;
+	header.append(reinterpret_cast<const char *>(&numColumns), sizeof(uint32));
+	header.append(reinterpret_cast<const char *>(&flags), sizeof(uint32));
+	header.append(reinterpret_cast<const char *>(&rowsPerGroup), sizeof(uint64));
+	for (vector<pair<string, StatType> >::const_iterator it = columns.begin(); it != columns.end(); ++it){
+		uint32 type = it->second;
+		uint32 length = it->first.size();
+		header.append(reinterpret_cast<const char *>(&type), sizeof(uint32));
+		header.append(reinterpret_cast<const char *>(&length), sizeof(uint32));
+		header.append(it->first);
+	}
+	writePadded(header.data(), header.size());
+	buffer.resize(columns.size() * rowsPerGroup);
+	headerWritten = true;
+}
+
+void IntervalStatsWriter::writeGroup(){
+	//a partial group is compacted so that its columns are numRows values apart
+	if (numRows != rowsPerGroup){
+		for (uint64 c = 1; c < columns.size(); c++){
+			copy(buffer.begin() + c * rowsPerGroup, buffer.begin() + c * rowsPerGroup + numRows, buffer.begin() + c * numRows);
+		}
+	}
+	const char *data = reinterpret_cast<const char *>(buffer.data());
+	uLong size = columns.size() * numRows * sizeof(uint64);
+	vector<Bytef> compressed;
+	if (compress){
+		uLongf compressedSize = compressBound(size);
+		compressed.resize(compressedSize);
+		if (compress2(compressed.data(), &compressedSize, reinterpret_cast<const Bytef *>(data), size, Z_BEST_SPEED) != Z_OK){
+			error("Could not compress statistics for file '%s'", fileName.c_str());
+		}
+		data = reinterpret_cast<const char *>(compressed.data());
+		size = compressedSize;
+	}
+	uint64 groupHeader[2] = {numRows, (size + 7) & ~7ULL};
+	file.write(reinterpret_cast<const char *>(groupHeader), sizeof(groupHeader));
+	writePadded(data, size);
+	numRows = 0;
+}
+
+void IntervalStatsWriter::writePadded(const char *data, uint64 size){
+	static const char zeros[8] = {0};
+	file.write(data, size);
+	file.write(zeros, ((size + 7) & ~7ULL) - size);
+}
+
+IntervalStatsReader::IntervalStatsReader(const string& fileNameArg) : fileName(fileNameArg), file(fileNameArg.c_str(), ios::binary) {
+	if (!file.is_open()){
+		error("Could not open statistics file '%s'", fileName.c_str());
+	}
+	char magic[sizeof(INTERVAL_STATS_MAGIC) - 1];
+	uint32 numColumns, flags;
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char *>(&numColumns), sizeof(uint32));
+	file.read(reinterpret_cast<char *>(&flags), sizeof(uint32));
+	file.read(reinterpret_cast<char *>(&rowsPerGroup), sizeof(uint64));
+	if (!file || memcmp(magic, INTERVAL_STATS_MAGIC, sizeof(magic)) != 0){
+		error("File '%s' is not a binary statistics file", fileName.c_str());
+	}
+	compress = (flags & INTERVAL_STATS_COMPRESSED) != 0;
+	uint64 headerSize = sizeof(magic) + 2 * sizeof(uint32) + sizeof(uint64);
+	for (uint32 i = 0; i < numColumns; i++){
+		uint32 type, length;
+		file.read(reinterpret_cast<char *>(&type), sizeof(uint32));
+		file.read(reinterpret_cast<char *>(&length), sizeof(uint32));
+		string name(length, ' ');
+		file.read(&name[0], length);
+		if (!file || type > STAT_DOUBLE){
+			error("Error reading header of statistics file '%s'", fileName.c_str());
+		}
+		columns.emplace_back(name, static_cast<StatType>(type));
+		headerSize += 2 * sizeof(uint32) + length;
 	}
+	file.ignore(((headerSize + 7) & ~7ULL) - headerSize);
 }
 
+bool IntervalStatsReader::readGroup(vector<uint64> *cells, uint64 *numRows){
+	uint64 groupHeader[2];
+	file.read(reinterpret_cast<char *>(groupHeader), sizeof(groupHeader));
+	if (file.gcount() == 0){
+		return false;
+	}
+	if (!file || groupHeader[0] > rowsPerGroup){
+		error("Error reading statistics file '%s'", fileName.c_str());
+	}
+	*numRows = groupHeader[0];
+	uLongf size = columns.size() * *numRows * sizeof(uint64);
+	cells->resize(columns.size() * *numRows);
+	if (compress){
+		vector<Bytef> compressed(groupHeader[1]);
+		file.read(reinterpret_cast<char *>(compressed.data()), compressed.size());
+		uLongf uncompressedSize = size;
+		if (!file || uncompress(reinterpret_cast<Bytef *>(cells->data()), &uncompressedSize, compressed.data(), compressed.size()) != Z_OK || uncompressedSize != size){
+			error("Error reading statistics file '%s'", fileName.c_str());
+		}
+	} else {
+		if (groupHeader[1] != size){
+			error("Error reading statistics file '%s'", fileName.c_str());
+		}
+		file.read(reinterpret_cast<char *>(cells->data()), size);
+		if (!file){
+			error("Error reading statistics file '%s'", fileName.c_str());
+		}
+	}
+	return true;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+#include "Telemetry.H"
+#include "Error.H"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+TelemetryServer::TelemetryServer(const string& pathArg, StatContainer *statsArg, const string& statNames) :
+		path(pathArg),
+		stats(statsArg),
+		snapshot("state starting\n"),
+		lastEvents(0) {
+	istringstream iss(statNames);
+	string name;
+	while (getline(iss, name, ',')){
+		if (!name.empty()){
+			selection.emplace_back(name);
+		}
+	}
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)){
+		error("Telemetry socket path '%s' is too long", path.c_str());
+	}
+	strcpy(addr.sun_path, path.c_str());
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0){
+		error("Could not create telemetry socket: %s", strerror(errno));
+	}
+	unlink(path.c_str()); //left behind by a simulation that did not finish
+	if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 || listen(fd, 16) != 0){
+		error("Could not bind telemetry socket '%s': %s", path.c_str(), strerror(errno));
+	}
+	gettimeofday(&lastTime, NULL);
+	server = thread(&TelemetryServer::serve, this);
+}
+
+TelemetryServer::~TelemetryServer(){
+	//shutting down the listening socket makes the blocked accept return
+	shutdown(fd, SHUT_RDWR);
+	server.join();
+	close(fd);
+	unlink(path.c_str());
+}
+
+void TelemetryServer::serve(){
+	while (true){
+		int client = accept(fd, NULL, NULL);
+		if (client < 0){
+			if (errno == EINTR || errno == ECONNABORTED){
+				continue;
+			}
+			break;
+		}
+		string current;
+		{
+			lock_guard<mutex> guard(snapshotMutex);
+			current = snapshot;
+		}
+		size_t sent = 0;
+		while (sent < current.size()){
+			ssize_t ret = send(client, current.data() + sent, current.size() - sent, MSG_NOSIGNAL);
+			if (ret <= 0){
+				break;
+			}
+			sent += ret;
+		}
+		close(client);
+	}
+}
+
+void TelemetryServer::publish(uint64 timestamp, uint64 numEvents, uint64 pendingEvents, bool finished){
+	struct timeval current;
+	gettimeofday(&current, NULL);
+	double seconds = (current.tv_sec - lastTime.tv_sec) + static_cast<double>(current.tv_usec - lastTime.tv_usec) / 1000000;
+	double eventRate = seconds > 0 ? (numEvents - lastEvents) / seconds : 0;
+	lastTime = current;
+	lastEvents = numEvents;
+
+	ostringstream oss;
+	oss.setf(std::ios::fixed);
+	oss.precision(2);
+	oss << "state " << (finished ? "finished" : "running") << endl;
+	oss << "timestamp " << timestamp << endl;
+	oss << "events " << numEvents << endl;
+	oss << "event_rate " << eventRate << endl;
+	oss << "pending_events " << pendingEvents << endl;
+	vector<StatBase*> found;
+	for (vector<string>::const_iterator it = selection.begin(); it != selection.end(); ++it){
+		if (!it->empty() && (*it)[it->size() - 1] == '*'){
+			stats->findPrefix(it->substr(0, it->size() - 1), &found);
+		} else {
+			StatBase *stat = stats->find(*it);
+			found.assign(stat == 0 ? 0 : 1, stat);
+		}
+		for (vector<StatBase*>::const_iterator sit = found.begin(); sit != found.end(); ++sit){
+			oss << (*sit)->getName() << " " << (*sit)->getValueAsString() << endl;
+		}
+	}
+
+	lock_guard<mutex> guard(snapshotMutex);
+	snapshot = oss.str();
+}
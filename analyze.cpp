@@ -7,16 +7,18 @@
 #include "Arguments.H"
 #include "Cache.H"
 #include "Error.H"
+#include "PageTable.H"
+#include "ShardedPageMap.H"
+#include "SimPoint.H"
+#include "StackDistance.H"
 #include "TraceHandler.H"
 #include "Statistics.H"
 
-#include <bitset>
 
 #include <cmath>
 #include <cassert>
 
 
-#define MAX_BITSET_SIZE 256
 
 struct Address {
 	unsigned numBlocks;
@@ -75,10 +77,71 @@ struct Address {
 struct PageCounter {
 	uint64 reads;
 	uint64 writes;
-	bitset<MAX_BITSET_SIZE> readBlocks;
-	bitset<MAX_BITSET_SIZE> writtenBlocks;
 };
 
+//the block bits of a page counter interleave a read bit and a written bit per block
+#define READ_BITS 0x5555555555555555ULL
+
+static unsigned counterWords(unsigned numBlocks){
+	return (2 * numBlocks + 63) / 64;
+}
+
+struct BlockCounts {
+	unsigned read;
+	unsigned written;
+	unsigned accessed;
+	BlockCounts(const uint64 *blocks, unsigned numWords) : read(0), written(0), accessed(0) {
+		for (unsigned i = 0; i < numWords; i++){
+			read += __builtin_popcountll(blocks[i] & READ_BITS);
+			written += __builtin_popcountll(blocks[i] & ~READ_BITS);
+			accessed += __builtin_popcountll((blocks[i] | (blocks[i] >> 1)) & READ_BITS);
+		}
+	}
+};
+
+enum PageUpdateType {
+	PAGE_READ,
+	PAGE_WRITE,
+	PAGE_READ_BLOCK, //marks a block as read without counting another read
+	PAGE_WRITE_BLOCK,
+	PAGE_INSTR
+};
+
+static void updatePageCounter(PageCounter *pc, uint64 *blocks, const ShardedPageMap<PageCounter>::Update& update){
+	switch (update.type){
+	case PAGE_READ:
+		pc->reads++;
+		PageTable<PageCounter>::setBit(blocks, 2 * update.block);
+		break;
+	case PAGE_WRITE:
+		pc->writes++;
+		PageTable<PageCounter>::setBit(blocks, 2 * update.block + 1);
+		break;
+	case PAGE_READ_BLOCK:
+		PageTable<PageCounter>::setBit(blocks, 2 * update.block);
+		break;
+	case PAGE_WRITE_BLOCK:
+		PageTable<PageCounter>::setBit(blocks, 2 * update.block + 1);
+		break;
+	default:
+		assert(false);
+	}
+}
+
+static void updateBlocks(uint8 *unused, uint64 *blocks, const ShardedPageMap<uint8>::Update& update){
+	PageTable<uint8>::setBit(blocks, update.block);
+}
+
+static void updatePageTuple(tuple<uint64, uint64, uint64> *counts, uint64 *unused, const ShardedPageMap<tuple<uint64, uint64, uint64> >::Update& update){
+	if (update.type == PAGE_INSTR){
+		get<0>(*counts)++;
+	} else if (update.type == PAGE_READ){
+		get<1>(*counts)++;
+	} else {
+		get<2>(*counts)++;
+	}
+}
+
 struct PageInfo {
 	uint32 reads;
 	uint32 writes;
@@ -95,7 +158,7 @@ int main(int argc, char * argv[]){
 	OptionalArgument<string> statsFile(&args, "stats", "name of statistics file", "", false);
 	OptionalArgument<string> traceFile(&args, "trace_file", "name of output trace file", "", false);
 
-	OptionalArgument<string> type(&args, "type", "type of analysis (trace|trace_before_cache|blocks|page|cache)", "trace");
+	OptionalArgument<string> type(&args, "type", "type of analysis (trace|trace_before_cache|blocks|page|cache|simpoints|stack_distance)", "trace");
 
 	OptionalArgument<unsigned> cacheSizeArg(&args, "cache_size", "Cache sizes in kilobytes", 2048);
 	OptionalArgument<unsigned> assocArg(&args, "cache_assoc", "Cache associativity", 16);
@@ -108,8 +171,17 @@ int main(int argc, char * argv[]){
 	OptionalArgument<unsigned> blockSizeEndArg(&args, "block_size_end", "End of block sizes", 64);
 
 
+	OptionalArgument<unsigned> threads(&args, "threads", "number of threads that own the page counters (trace, trace_before_cache, blocks and page analyses)", 1);
+	OptionalArgument<double> samplingRate(&args, "sampling_rate", "fraction of the blocks tracked to compute fully associative stack distances (1 tracks all blocks)", 1.0);
+
 	OptionalArgument<uint64> period(&args, "period", "number of instructions between trace entries", 100000);
 
+	OptionalArgument<string> simPointsFile(&args, "simpoints_file", "name of output simulation points file", "", false);
+	OptionalArgument<unsigned> dimensions(&args, "dimensions", "number of dimensions of the projected interval vectors", 15);
+	OptionalArgument<unsigned> clusters(&args, "clusters", "maximum number of simulation points", 10);
+	OptionalArgument<unsigned> iterations(&args, "iterations", "maximum number of k-means iterations", 100);
+	OptionalArgument<uint64> seed(&args, "seed", "seed for the projection and the k-means initialization", 1);
+
 
 
 	if (args.parse(argc, argv)){
@@ -117,13 +189,16 @@ int main(int argc, char * argv[]){
 		return -1;
 	}
 
+	if (threads.getValue() == 0){
+		error("The number of threads must be greater than 0");
+	}
+
 	if (type.getValue() == "trace"){
 		StatContainer stats;
 		CacheModel cache("Cache", "Cache", &stats, cacheSizeArg.getValue(), blockSize.getValue(), assocArg.getValue(), CACHE_LRU, pageSize.getValue());
 
 		CompressedTraceReader reader(inputFile.getValue(), GZIP);
 		Address address(pageSize.getValue(), blockSize.getValue());
-		assert(address.numBlocks <= MAX_BITSET_SIZE);
 
 //		FILE *trace = fopen(traceFile.getValue().c_str(), "w");
 //		if (trace == 0){
@@ -135,9 +210,9 @@ int main(int argc, char * argv[]){
 			error("Could not open file %s", traceFile.getValue().c_str());
 		}
 
-		set<addrint> unique;
+		PageTable<uint8> unique;
 
-		map<addrint, PageCounter> pages;
+		ShardedPageMap<PageCounter> pages(threads.getValue(), counterWords(address.numBlocks), updatePageCounter);
 		uint64 icount = 0;
 
 		TraceEntry entry;
@@ -145,34 +220,25 @@ int main(int argc, char * argv[]){
 			if (entry.instr){
 				icount++;
 				if (icount % period.getValue() == 0){
-					//fwrite(&icount, sizeof(uint64), 1, trace);
+					pages.wait();
 					gzwrite(trace, &icount, sizeof(uint64));
 					uint32 size = pages.size();
-					//fwrite(&size, sizeof(uint32), 1, trace);
 					gzwrite(trace, &size, sizeof(uint32));
-					//cout << icount << "\t" << pages.size() << "\t";
-					for (map<addrint, PageCounter>::iterator it = pages.begin(); it != pages.end(); ++it){
-						addrint page = it->first;
-						uint32 reads = it->second.reads;
-						uint32 writes = it->second.writes;
-						uint8 readBlocks = it->second.readBlocks.count();
-						uint8 writtenBlocks = it->second.writtenBlocks.count();
-						uint8 accessedBlocks = (it->second.readBlocks | it->second.writtenBlocks).count();
-//						fwrite(&page, sizeof(addrint), 1, trace);
-//						fwrite(&reads, sizeof(uint32), 1, trace);
-//						fwrite(&writes, sizeof(uint32), 1, trace);
-//						fwrite(&readBlocks, sizeof(uint8), 1, trace);
-//						fwrite(&writtenBlocks, sizeof(uint8), 1, trace);
-//						fwrite(&accessedBlocks, sizeof(uint8), 1, trace);
+					unsigned numWords = counterWords(address.numBlocks);
+					pages.forEach([trace, numWords](addrint page, const PageCounter& pc, const uint64 *blocks){
+						uint32 reads = pc.reads;
+						uint32 writes = pc.writes;
+						BlockCounts counts(blocks, numWords);
+						uint8 readBlocks = counts.read;
+						uint8 writtenBlocks = counts.written;
+						uint8 accessedBlocks = counts.accessed;
 						gzwrite(trace, &page, sizeof(addrint));
 						gzwrite(trace, &reads, sizeof(uint32));
 						gzwrite(trace, &writes, sizeof(uint32));
 						gzwrite(trace, &readBlocks, sizeof(uint8));
 						gzwrite(trace, &writtenBlocks, sizeof(uint8));
 						gzwrite(trace, &accessedBlocks, sizeof(uint8));
-						//cout << it->first << "\t" << it->second.reads << "\t" << it->second.writes << "\t" << it->second.readBlocks.count() << "\t" << it->second.writtenBlocks.count() << "\t" << (it->second.readBlocks | it->second.writtenBlocks).count() << "\t";
-					}
-					//cout << endl;
+					});
 					pages.clear();
 				}
 			}
@@ -195,19 +261,10 @@ int main(int argc, char * argv[]){
 			if (res == CacheModel::HIT){
 
 			} else if (res == CacheModel::MISS_WITHOUT_EVICTION || res == CacheModel::MISS_WITH_EVICTION){
-				PageCounter &pc = pages[firstPage];
-				pc.reads++;
-				pc.readBlocks.set(firstBlock);
+				pages.update(firstPage, firstBlock, PAGE_READ);
 			} else  if(res == CacheModel::MISS_WITH_WRITEBACK){
-				PageCounter &pc = pages[firstPage];
-				pc.reads++;
-				pc.readBlocks.set(firstBlock);
-
-				addrint evictedPage = address.getPageIndex(evictedAddr);
-				addrint evictedBlock = address.getBlockIndex(evictedAddr);
-				PageCounter &pc2 = pages[evictedPage];
-				pc2.writes++;
-				pc2.writtenBlocks.set(evictedBlock);
+				pages.update(firstPage, firstBlock, PAGE_READ);
+				pages.update(address.getPageIndex(evictedAddr), address.getBlockIndex(evictedAddr), PAGE_WRITE);
 			} else {
 				assert(false);
 			}
@@ -217,19 +274,10 @@ int main(int argc, char * argv[]){
 				if (res == CacheModel::HIT){
 
 				} else if (res == CacheModel::MISS_WITHOUT_EVICTION || res == CacheModel::MISS_WITH_EVICTION){
-					PageCounter &pc = pages[secondPage];
-					pc.reads++;
-					pc.readBlocks.set(secondBlock);
+					pages.update(secondPage, secondBlock, PAGE_READ);
 				} else  if(res == CacheModel::MISS_WITH_WRITEBACK){
-					PageCounter &pc = pages[secondPage];
-					pc.reads++;
-					pc.readBlocks.set(secondBlock);
-
-					addrint evictedPage = address.getPageIndex(evictedAddr);
-					addrint evictedBlock = address.getBlockIndex(evictedAddr);
-					PageCounter &pc2 = pages[evictedPage];
-					pc2.writes++;
-					pc2.writtenBlocks.set(evictedBlock);
+					pages.update(secondPage, secondBlock, PAGE_READ);
+					pages.update(address.getPageIndex(evictedAddr), address.getBlockIndex(evictedAddr), PAGE_WRITE);
 				} else {
 					assert(false);
 				}
@@ -246,7 +294,6 @@ int main(int argc, char * argv[]){
 	} else if (type.getValue() == "trace_before_cache"){
 		CompressedTraceReader reader(inputFile.getValue(), GZIP);
 		Address address(pageSize.getValue(), blockSize.getValue());
-		assert(address.numBlocks <= MAX_BITSET_SIZE);
 
 //		FILE *trace = fopen(traceFile.getValue().c_str(), "w");
 //		if (trace == 0){
@@ -258,7 +305,7 @@ int main(int argc, char * argv[]){
 			error("Could not open file %s", traceFile.getValue().c_str());
 		}
 
-		map<addrint, PageCounter> pages;
+		ShardedPageMap<PageCounter> pages(threads.getValue(), counterWords(address.numBlocks), updatePageCounter);
 		uint64 icount = 0;
 
 		TraceEntry entry;
@@ -266,33 +313,27 @@ int main(int argc, char * argv[]){
 			if (entry.instr){
 				icount++;
 				if (icount % period.getValue() == 0){
-					//fwrite(&icount, sizeof(uint64), 1, trace);
+					pages.wait();
 					gzwrite(trace, &icount, sizeof(uint64));
 					uint32 size = pages.size();
-					//fwrite(&size, sizeof(uint32), 1, trace);
 					gzwrite(trace, &size, sizeof(uint32));
 					cout << icount << "\t" << pages.size() << "\t";
-					for (map<addrint, PageCounter>::iterator it = pages.begin(); it != pages.end(); ++it){
-						addrint page = it->first;
-						uint32 reads = it->second.reads;
-						uint32 writes = it->second.writes;
-						uint8 readBlocks = it->second.readBlocks.count();
-						uint8 writtenBlocks = it->second.writtenBlocks.count();
-						uint8 accessedBlocks = (it->second.readBlocks | it->second.writtenBlocks).count();
-//						fwrite(&page, sizeof(addrint), 1, trace);
-//						fwrite(&reads, sizeof(uint32), 1, trace);
-//						fwrite(&writes, sizeof(uint32), 1, trace);
-//						fwrite(&readBlocks, sizeof(uint8), 1, trace);
-//						fwrite(&writtenBlocks, sizeof(uint8), 1, trace);
-//						fwrite(&accessedBlocks, sizeof(uint8), 1, trace);
+					unsigned numWords = counterWords(address.numBlocks);
+					pages.forEach([trace, numWords](addrint page, const PageCounter& pc, const uint64 *blocks){
+						uint32 reads = pc.reads;
+						uint32 writes = pc.writes;
+						BlockCounts counts(blocks, numWords);
+						uint8 readBlocks = counts.read;
+						uint8 writtenBlocks = counts.written;
+						uint8 accessedBlocks = counts.accessed;
 						gzwrite(trace, &page, sizeof(addrint));
 						gzwrite(trace, &reads, sizeof(uint32));
 						gzwrite(trace, &writes, sizeof(uint32));
 						gzwrite(trace, &readBlocks, sizeof(uint8));
 						gzwrite(trace, &writtenBlocks, sizeof(uint8));
 						gzwrite(trace, &accessedBlocks, sizeof(uint8));
-						cout << it->first << "\t" << it->second.reads << "\t" << it->second.writes << "\t" << it->second.readBlocks.count() << "\t" << it->second.writtenBlocks.count() << "\t" << (it->second.readBlocks | it->second.writtenBlocks).count() << "\t";
-					}
+						cout << page << "\t" << pc.reads << "\t" << pc.writes << "\t" << counts.read << "\t" << counts.written << "\t" << counts.accessed << "\t";
+					});
 					cout << endl;
 					pages.clear();
 				}
@@ -305,36 +346,16 @@ int main(int argc, char * argv[]){
 
 
 			if (firstPage == secondPage){
-				PageCounter &pc = pages[firstPage];
-				if (entry.read){
-					pc.reads++;
-					pc.readBlocks.set(firstBlock);
-					pc.readBlocks.set(secondBlock);
-				} else {
-					pc.writes++;
-					pc.writtenBlocks.set(firstBlock);
-					pc.writtenBlocks.set(secondBlock);
+				pages.update(firstPage, firstBlock, entry.read ? PAGE_READ : PAGE_WRITE);
+				if (secondBlock != firstBlock){
+					pages.update(firstPage, secondBlock, entry.read ? PAGE_READ_BLOCK : PAGE_WRITE_BLOCK);
 				}
 			} else if (firstPage == secondPage - 1){
 				if (firstBlock == secondBlock){
 					error("Access covers two pages but only one block");
 				}
-				PageCounter &pc1 = pages[firstPage];
-				if (entry.read){
-					pc1.reads++;
-					pc1.readBlocks.set(firstBlock);
-				} else {
-					pc1.writes++;
-					pc1.writtenBlocks.set(firstBlock);
-				}
-				PageCounter &pc2 = pages[secondPage];
-				if (entry.read){
-					pc2.reads++;
-					pc2.readBlocks.set(secondBlock);
-				} else {
-					pc2.writes++;
-					pc2.writtenBlocks.set(secondBlock);
-				}
+				pages.update(firstPage, firstBlock, entry.read ? PAGE_READ : PAGE_WRITE);
+				pages.update(secondPage, secondBlock, entry.read ? PAGE_READ : PAGE_WRITE);
 			} else{
 				error("Access covers more than two pages");
 			}
@@ -347,24 +368,19 @@ int main(int argc, char * argv[]){
 	} else if (type.getValue() == "blocks"){
 		CompressedTraceReader reader(inputFile.getValue(), GZIP);
 		Address address(pageSize.getValue(), blockSize.getValue());
-		assert(address.numBlocks <= MAX_BITSET_SIZE);
-		map<addrint, bitset<MAX_BITSET_SIZE> >pages;
+		ShardedPageMap<uint8> pages(threads.getValue(), (address.numBlocks + 63) / 64, updateBlocks);
 
 		TraceEntry entry;
 		while(reader.readEntry(&entry)){
-			//cout << address.getBlockIndex(entry.address) << endl;
-			pages[address.getPageIndex(entry.address)][address.getBlockIndex(entry.address)] = true;
-
+			pages.update(address.getPageIndex(entry.address), address.getBlockIndex(entry.address), PAGE_READ);
 		}
+		pages.wait();
 
 		map<unsigned, unsigned> hist;
-		for (map<addrint, bitset<MAX_BITSET_SIZE> >::iterator it = pages.begin(); it != pages.end(); ++it){
-			hist[it->second.count()]++;
-		}
-
-		for (map<unsigned, unsigned>::iterator it = hist.begin(); it != hist.end(); ++it){
-
-		}
+		unsigned numWords = (address.numBlocks + 63) / 64;
+		pages.forEach([&hist, numWords](addrint page, uint8 unused, const uint64 *blocks){
+			hist[PageTable<uint8>::countBits(blocks, numWords)]++;
+		});
 
 		if (statsFile.getValue().empty()){
 			for (unsigned i = 1; i <= address.numBlocks; i++){
@@ -382,38 +398,136 @@ int main(int argc, char * argv[]){
 	} else if (type.getValue() == "page"){
 		CompressedTraceReader reader(inputFile.getValue(), GZIP);
 		Address address(pageSize.getValue(), blockSize.getValue());
-		map<addrint, tuple<uint64, uint64, uint64> >pages;
+		ShardedPageMap<tuple<uint64, uint64, uint64> > pages(threads.getValue(), 0, updatePageTuple);
+
+		TraceEntry entry;
+		while(reader.readEntry(&entry)){
+			pages.update(address.getPageIndex(entry.address), 0, entry.instr ? PAGE_INSTR : (entry.read ? PAGE_READ : PAGE_WRITE));
+		}
+		pages.wait();
+
+		ofstream file;
+		if (!statsFile.getValue().empty()){
+			file.open(statsFile.getValue().c_str());
+		}
+		ostream& out = statsFile.getValue().empty() ? cout : file;
+		out << "#page\tinstr\tdataReads\tdataWrites" << endl;
+		pages.forEach([&out](addrint page, const tuple<uint64, uint64, uint64>& counts, const uint64 *unused){
+			out << page << "\t" << get<0>(counts) << "\t" << get<1>(counts) << "\t "<< get<2>(counts) << endl;
+		});
+
+
+	} else if (type.getValue() == "simpoints"){
+		CompressedTraceReader reader(inputFile.getValue(), GZIP);
+		Address address(pageSize.getValue(), blockSize.getValue());
+		SimPointAnalyzer analyzer(dimensions.getValue(), seed.getValue());
+		uint64 icount = 0;
 
 		TraceEntry entry;
 		while(reader.readEntry(&entry)){
-			//cout << address.getBlockIndex(entry.address) << endl;
 			if (entry.instr){
-				get<0>(pages[address.getPageIndex(entry.address)])++;
-			} else {
-				if (entry.read){
-					get<1>(pages[address.getPageIndex(entry.address)])++;
-				} else {
-					get<2>(pages[address.getPageIndex(entry.address)])++;
+				if (icount != 0 && icount % period.getValue() == 0){
+					analyzer.endInterval();
 				}
+				icount++;
 			}
-
+			addrint firstPage = address.getPageIndex(entry.address);
+			addrint secondPage = address.getSecondPageIndex(entry.address, entry.size);
+			analyzer.access(firstPage, entry.instr);
+			if (secondPage != firstPage){
+				analyzer.access(secondPage, entry.instr);
+			}
+		}
+		//the last interval is only used if it is complete
+		if (icount != 0 && icount % period.getValue() == 0){
+			analyzer.endInterval();
 		}
 
+		vector<SimPoint> points;
+		analyzer.cluster(clusters.getValue(), iterations.getValue(), &points);
+		SimPointFile file(period.getValue(), analyzer.getNumIntervals(), points);
 
-		if (statsFile.getValue().empty()){
-			cout << "#page\tinstr\tdataReads\tdataWrites" << endl;
-			for (map<addrint, tuple<uint64, uint64, uint64> >::iterator it = pages.begin(); it != pages.end(); ++it){
-				cout << it->first << "\t" << get<0>(it->second) << "\t" << get<1>(it->second) << "\t "<< get<2>(it->second) << endl;
+		if (simPointsFile.getValue().empty()){
+			cout << "#interval\tweight" << endl;
+			for (vector<SimPoint>::const_iterator it = points.begin(); it != points.end(); ++it){
+				cout << it->interval << "\t" << it->weight << endl;
 			}
 		} else {
-			ofstream out(statsFile.getValue().c_str());
-			out << "#page\tinstr\tdataReads\tdataWrites" << endl;
-			for (map<addrint, tuple<uint64, uint64, uint64> >::iterator it = pages.begin(); it != pages.end(); ++it){
-				out << it->first << "\t" << get<0>(it->second) << "\t" << get<1>(it->second) << "\t "<< get<2>(it->second) << endl;
+			file.write(simPointsFile.getValue());
+		}
+
+	} else if (type.getValue() == "stack_distance"){
+		//one pass over the trace for all the cache sizes, block sizes and associativities (up to cache_assoc)
+		CompressedTraceReader reader(inputFile.getValue(), GZIP);
+
+		uint64 cacheSizeStart = cacheSizeStartArg.getValue()*1024;
+		uint64 cacheSizeEnd = cacheSizeEndArg.getValue()*1024;
+		uint64 blockSizeStart = blockSizeStartArg.getValue();
+		uint64 blockSizeEnd = blockSizeEndArg.getValue();
+		unsigned maxAssoc = assocArg.getValue();
+
+		map<uint64, StackDistance*> fullyAssociative;
+		map<uint64, map<uint64, SetStackDistance*> > setAssociative;
+		map<uint64, unsigned> offsetWidths;
+		for (uint64 b = blockSizeStart; b <= blockSizeEnd; b *= 2){
+			fullyAssociative[b] = new StackDistance(samplingRate.getValue());
+			offsetWidths[b] = (unsigned) logb(b);
+			map<uint64, unsigned> depths;
+			for (uint64 s = cacheSizeStart; s <= cacheSizeEnd; s *= 2){
+				for (unsigned a = 1; a <= maxAssoc && a * b <= s; a *= 2){
+					unsigned& depth = depths[s / (a * b)];
+					depth = max(depth, a);
+				}
+			}
+			for (map<uint64, unsigned>::iterator it = depths.begin(); it != depths.end(); ++it){
+				setAssociative[b][it->first] = new SetStackDistance(it->first, it->second);
 			}
-			out.close();
 		}
 
+		TraceEntry entry;
+		while(reader.readEntry(&entry)){
+			for (uint64 b = blockSizeStart; b <= blockSizeEnd; b *= 2){
+				addrint firstBlock = entry.address >> offsetWidths[b];
+				addrint lastBlock = (entry.address + entry.size - 1) >> offsetWidths[b];
+				if (lastBlock - firstBlock > 1){
+					error("Access covers more than one cache block");
+				}
+				for (addrint block = firstBlock; block <= lastBlock; block++){
+					fullyAssociative[b]->access(block);
+					for (map<uint64, SetStackDistance*>::iterator it = setAssociative[b].begin(); it != setAssociative[b].end(); ++it){
+						it->second->access(block);
+					}
+				}
+			}
+		}
+
+		ofstream file;
+		if (!statsFile.getValue().empty()){
+			file.open(statsFile.getValue().c_str());
+		}
+		ostream& out = statsFile.getValue().empty() ? cout : file;
+		for (uint64 b = blockSizeStart; b <= blockSizeEnd; b *= 2){
+			out << "#Number of accesses tracked (Block size: " << b << ")" << endl;
+			out << "accesses_block_size_" << b << " " << fullyAssociative[b]->getAccesses() << endl << endl;
+			out << "#Number of distinct blocks tracked (Block size: " << b << ")" << endl;
+			out << "blocks_block_size_" << b << " " << fullyAssociative[b]->getNumBlocks() << endl << endl;
+			for (uint64 s = cacheSizeStart; s <= cacheSizeEnd; s *= 2){
+				ostringstream ossName, ossDesc;
+				if (s < 1024*1024){
+					ossName << "cache_size_" << (s/1024) << "K_block_size_" << b;
+					ossDesc << "Cache size: " << (s/1024) << "K Block size: " << b;
+				} else {
+					ossName << "cache_size_" << (s/1024/1024) << "M_block_size_" << b;
+					ossDesc << "Cache size: " << (s/1024/1024) << "M Block size: " << b;
+				}
+				out << "#Miss ratio of a fully associative LRU cache (" << ossDesc.str() << ")" << endl;
+				out << "fa_" << ossName.str() << "_miss_ratio " << fullyAssociative[b]->getMissRatio(s / b) << endl << endl;
+				for (unsigned a = 1; a <= maxAssoc && a * b <= s; a *= 2){
+					out << "#Miss ratio of a " << a << "-way LRU cache (" << ossDesc.str() << ")" << endl;
+					out << ossName.str() << "_assoc_" << a << "_miss_ratio " << setAssociative[b][s / (a * b)]->getMissRatio(a) << endl << endl;
+				}
+			}
+		}
 
 	} else if (type.getValue() == "cache"){
 
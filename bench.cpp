@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+/*
+ * This program runs the simulator over a matrix of configurations on a reference trace and writes a report with the
+ * throughput (the event rate of the simulation loop, which excludes the construction of the components, and the
+ * corresponding instruction rate), the wall-clock time and peak resident set size of the whole process and the key
+ * statistics of every configuration. If a baseline report is given, it flags result regressions (statistics that
+ * changed) and performance regressions (throughput or peak resident set size worse than the tolerance), and exits with a
+ * non-zero status if there is any. Throughput depends on the machine, so it is only compared if the baseline was
+ * written on the same host (recorded in every line of the report).
+ *
+ * Every line of the matrix file holds the name of a configuration followed by the options passed to sim. The report
+ * has a header line and one line per configuration, with tab separated columns, and can be used as a baseline.
+ */
+
+#include "Arguments.H"
+#include "Error.H"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+//statistics that must match the baseline exactly; instructions is the sum of the instructions executed by all CPUs
+const char *keyStats[] = {"final_timestamp", "total_events", "instructions", "L2_all_misses", "dram_read_requests", "dram_write_requests", "pcm_read_requests", "pcm_write_requests", "manager_total_migrations"};
+
+struct Configuration {
+	string name;
+	vector<string> options;
+};
+
+struct Result {
+	int status; //exit status of sim (128 plus the number of the signal if it was killed)
+	double wallTime; //in seconds
+	long peakRss; //in kilobytes
+	map<string, string> stats;
+};
+
+typedef map<string, map<string, string> > Report; //configuration name to column name to value
+
+vector<Configuration> readMatrix(const string& fileName){
+	ifstream in(fileName.c_str());
+	if (!in.is_open()){
+		error("Could not open matrix file '%s'", fileName.c_str());
+	}
+	vector<Configuration> matrix;
+	string line;
+	while (getline(in, line)){
+		istringstream iss(line);
+		Configuration conf;
+		if (!(iss >> conf.name) || conf.name[0] == '#'){
+			continue;
+		}
+		string option;
+		while (iss >> option){
+			conf.options.emplace_back(option);
+		}
+		matrix.emplace_back(conf);
+	}
+	return matrix;
+}
+
+void readStats(const string& fileName, map<string, string> *stats){
+	ifstream in(fileName.c_str());
+	if (!in.is_open()){
+		error("Could not open statistics file '%s'", fileName.c_str());
+	}
+	uint64 instructions = 0;
+	string line;
+	while (getline(in, line)){
+		istringstream iss(line);
+		string name, value;
+		if (line.empty() || line[0] == '#' || !(iss >> name >> value)){
+			continue;
+		}
+		(*stats)[name] = value;
+		const string suffix("_instructions_executed");
+		if (name.compare(0, 4, "cpu_") == 0 && name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0){
+			instructions += strtoull(value.c_str(), 0, 10);
+		}
+	}
+	(*stats)["instructions"] = to_string(instructions);
+}
+
+/*
+ * Runs sim with its standard output and error redirected to the log file and collects the wall-clock time and peak
+ * resident set size of the process
+ */
+Result run(const vector<string>& argv, const string& statsFile, const string& logFile){
+	Result result;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	pid_t pid = fork();
+	if (pid < 0){
+		error("Could not create process: %s", strerror(errno));
+	} else if (pid == 0){
+		int fd = open(logFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd >= 0){
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+		}
+		vector<char *> args;
+		for (vector<string>::const_iterator it = argv.begin(); it != argv.end(); ++it){
+			args.emplace_back(const_cast<char *>(it->c_str()));
+		}
+		args.emplace_back(static_cast<char *>(0));
+		execv(args[0], args.data());
+		_exit(127);
+	}
+	int status;
+	struct rusage usage;
+	if (wait4(pid, &status, 0, &usage) != pid){
+		error("Could not wait for process: %s", strerror(errno));
+	}
+	result.wallTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	result.peakRss = usage.ru_maxrss;
+	result.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+	if (result.status == 0){
+		readStats(statsFile, &result.stats);
+	}
+	return result;
+}
+
+string getStat(const map<string, string>& stats, const string& name){
+	map<string, string>::const_iterator it = stats.find(name);
+	return it == stats.end() ? "-" : it->second;
+}
+
+Report readReport(const string& fileName){
+	ifstream in(fileName.c_str());
+	if (!in.is_open()){
+		error("Could not open report file '%s'", fileName.c_str());
+	}
+	Report report;
+	vector<string> columns;
+	string line;
+	while (getline(in, line)){
+		vector<string> values;
+		size_t current;
+		size_t next = -1;
+		do {
+			current = next + 1;
+			next = line.find_first_of("\t", current);
+			values.emplace_back(line.substr(current, next - current));
+		} while (next != string::npos);
+		if (columns.empty()){
+			columns = values;
+		} else if (values.size() == columns.size()){
+			for (unsigned i = 1; i < columns.size(); i++){
+				report[values[0]][columns[i]] = values[i];
+			}
+		} else {
+			error("Malformed line in report file '%s': '%s'", fileName.c_str(), line.c_str());
+		}
+	}
+	return report;
+}
+
+double change(const string& base, const string& current){
+	double b = atof(base.c_str());
+	return b == 0 ? 0 : (atof(current.c_str()) - b) / b;
+}
+
+int main(int argc, char * argv[]){
+
+	ArgumentContainer args("bench", false);
+	PositionalArgument<string> simPath(&args, "sim", "simulator binary", "");
+	PositionalArgument<string> matrixFile(&args, "matrix_file", "configurations to run (name followed by the options of sim on each line)", "");
+	PositionalArgument<string> reportFile(&args, "report_file", "report to write (the statistics and logs of every run are written next to it)", "");
+	OptionalArgument<string> configFile(&args, "config", "configuration file passed to sim before the options of each configuration", "/dev/null");
+	OptionalArgument<string> trace(&args, "trace", "name of the reference trace", "texted");
+	OptionalArgument<string> tracePrefix(&args, "trace_prefix", "prefix of the reference trace files", "");
+	OptionalArgument<unsigned> copies(&args, "copies", "number of copies of the reference trace, each one run by its own CPU", 4);
+	OptionalArgument<string> baselineFile(&args, "baseline", "report to compare against (empty for no comparison)", "");
+	OptionalArgument<unsigned> repeat(&args, "repeat", "number of runs of each configuration (the fastest one is reported)", 5);
+	OptionalArgument<double> tolerance(&args, "tolerance", "relative loss of throughput or increase of peak resident set size that is flagged as a performance regression", 0.15);
+	OptionalArgument<string> hostArg(&args, "host", "identifier of the machine recorded in the report, which must match the one of the baseline for throughput to be compared (empty for the host name)", "");
+
+	if (args.parse(argc, argv)){
+		args.usage(cerr);
+		return -1;
+	}
+
+	if (repeat.getValue() == 0){
+		error("The number of runs must be greater than 0");
+	}
+	if (copies.getValue() == 0){
+		error("The number of copies of the reference trace must be greater than 0");
+	}
+
+	string host = hostArg.getValue();
+	if (host.empty()){
+		char name[256];
+		if (gethostname(name, sizeof(name)) != 0){
+			error("Could not get host name: %s", strerror(errno));
+		}
+		name[sizeof(name) - 1] = 0;
+		host = name;
+	}
+
+	vector<Configuration> matrix = readMatrix(matrixFile.getValue());
+	Report baseline;
+	if (!baselineFile.getValue().empty()){
+		baseline = readReport(baselineFile.getValue());
+	}
+
+	ofstream out(reportFile.getValue().c_str());
+	if (!out.is_open()){
+		error("Could not open report file '%s'", reportFile.getValue().c_str());
+	}
+	out << "configuration\thost\tstatus\twall_time\tevents_per_second\tinstructions_per_second\tpeak_rss_kb";
+	for (unsigned i = 0; i < sizeof(keyStats) / sizeof(keyStats[0]); i++){
+		out << '\t' << keyStats[i];
+	}
+	out << '\n';
+	out.setf(ios::fixed);
+
+	unsigned resultRegressions = 0;
+	unsigned performanceRegressions = 0;
+	for (vector<Configuration>::const_iterator conf = matrix.begin(); conf != matrix.end(); ++conf){
+		string statsFile = reportFile.getValue() + "." + conf->name + ".stats";
+		string logFile = reportFile.getValue() + "." + conf->name + ".log";
+		vector<string> simArgs = {simPath.getValue(), configFile.getValue()};
+		simArgs.insert(simArgs.end(), copies.getValue(), trace.getValue());
+		simArgs.insert(simArgs.end(), {"-trace_prefix", tracePrefix.getValue(), "-progress_period", "0", "-stats", statsFile});
+		simArgs.insert(simArgs.end(), conf->options.begin(), conf->options.end());
+
+		Result best;
+		bool deterministic = true;
+		for (unsigned i = 0; i < repeat.getValue(); i++){
+			Result result = run(simArgs, statsFile, logFile);
+			if (i == 0){
+				best = result;
+			} else {
+				deterministic = deterministic && result.status == best.status;
+				for (unsigned j = 0; j < sizeof(keyStats) / sizeof(keyStats[0]); j++){
+					deterministic = deterministic && getStat(result.stats, keyStats[j]) == getStat(best.stats, keyStats[j]);
+				}
+				if (atof(getStat(result.stats, "event_rate").c_str()) > atof(getStat(best.stats, "event_rate").c_str())){
+					best.stats["event_rate"] = result.stats["event_rate"];
+				}
+				if (result.wallTime < best.wallTime){
+					best.wallTime = result.wallTime;
+				}
+				if (result.peakRss > best.peakRss){
+					best.peakRss = result.peakRss;
+				}
+			}
+		}
+
+		map<string, string> row;
+		row["status"] = to_string(best.status);
+		ostringstream oss;
+		oss.setf(ios::fixed);
+		oss.precision(3);
+		oss << best.wallTime;
+		row["wall_time"] = oss.str();
+		if (best.status == 0){
+			double eventRate = atof(getStat(best.stats, "event_rate").c_str());
+			double events = atof(getStat(best.stats, "total_events").c_str());
+			oss.str("");
+			oss.precision(0);
+			oss << eventRate;
+			row["events_per_second"] = oss.str();
+			oss.str("");
+			oss << (events == 0 ? 0 : atof(getStat(best.stats, "instructions").c_str()) * eventRate / events);
+			row["instructions_per_second"] = oss.str();
+		} else {
+			row["events_per_second"] = "-";
+			row["instructions_per_second"] = "-";
+		}
+		row["peak_rss_kb"] = to_string(best.peakRss);
+		for (unsigned i = 0; i < sizeof(keyStats) / sizeof(keyStats[0]); i++){
+			row[keyStats[i]] = getStat(best.stats, keyStats[i]);
+		}
+
+		out << conf->name << '\t' << host << '\t' << row["status"] << '\t' << row["wall_time"] << '\t' << row["events_per_second"] << '\t' << row["instructions_per_second"] << '\t' << row["peak_rss_kb"];
+		for (unsigned i = 0; i < sizeof(keyStats) / sizeof(keyStats[0]); i++){
+			out << '\t' << row[keyStats[i]];
+		}
+		out << '\n';
+
+		cout << conf->name << ": ";
+		if (best.status == 0){
+			cout << row["events_per_second"] << " events/s, " << row["instructions_per_second"] << " instructions/s, " << row["peak_rss_kb"] << " KB";
+		} else {
+			cout << "failed with status " << best.status << " (see " << logFile << ")";
+		}
+		if (!deterministic){
+			cout << endl << "\tRESULT REGRESSION: runs are not deterministic";
+			resultRegressions++;
+		}
+		if (!baselineFile.getValue().empty()){
+			Report::iterator base = baseline.find(conf->name);
+			if (base == baseline.end()){
+				cout << endl << "\tnot in baseline";
+			} else {
+				bool same = true;
+				for (unsigned i = 0; i < sizeof(keyStats) / sizeof(keyStats[0]); i++){
+					if (base->second[keyStats[i]] != row[keyStats[i]]){
+						cout << endl << "\tRESULT REGRESSION: " << keyStats[i] << " changed from " << base->second[keyStats[i]] << " to " << row[keyStats[i]];
+						same = false;
+					}
+				}
+				if (base->second["status"] != row["status"]){
+					cout << endl << "\tRESULT REGRESSION: status changed from " << base->second["status"] << " to " << row["status"];
+					same = false;
+				}
+				if (!same){
+					resultRegressions++;
+				} else if (best.status == 0){
+					bool sameHost = base->second["host"] == host;
+					double events = sameHost ? change(base->second["events_per_second"], row["events_per_second"]) : 0;
+					double rss = change(base->second["peak_rss_kb"], row["peak_rss_kb"]);
+					cout.precision(1);
+					cout << fixed << " (" << showpos;
+					if (sameHost){
+						cout << events * 100 << "% events/s, ";
+					}
+					cout << rss * 100 << "% peak RSS" << noshowpos << ")";
+					if (events < -tolerance.getValue() || rss > tolerance.getValue()){
+						cout << endl << "\tPERFORMANCE REGRESSION";
+						performanceRegressions++;
+					}
+				} else {
+					cout << " (also in baseline)";
+				}
+			}
+		}
+		cout << endl;
+	}
+
+	out.close();
+	if (out.fail()){
+		error("Error writing report file '%s'", reportFile.getValue().c_str());
+	}
+
+	if (!baselineFile.getValue().empty()){
+		if (!baseline.empty() && baseline.begin()->second["host"] != host){
+			cout << "Throughput not compared (the baseline was written on a different host than " << host << ")" << endl;
+		}
+		cout << resultRegressions << " result regressions and " << performanceRegressions << " performance regressions" << endl;
+	}
+
+	return resultRegressions + performanceRegressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+/*
+ * This program combines the statistics of the simulations of the simulation points of a trace
+ * into estimates of the statistics of the whole trace.
+ * The statistics of simulation point i are read from <stats_prefix><i><stats_suffix>.
+ * Statistics that add up over the execution (counts and times) are averaged with the weights of the simulation points.
+ * Statistics computed from other statistics (their formula follows the description in the statistics file), such as
+ * IPC, averages and rates, are recomputed from the combined statistics, so that, for example, the IPC is the total of
+ * the instructions over the total of the cycles instead of the average of the IPCs. Derived statistics that cannot be
+ * recomputed (percentiles) are left out.
+ */
+
+#include "Arguments.H"
+#include "Error.H"
+#include "SimPoint.H"
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+/*
+ * Computes the combined value of a derived statistic from the combined values of its operands (which can be derived too).
+ * Returns false if the formula is not a binary operation or an operand cannot be combined.
+ */
+bool evaluate(const string& name, const map<string, string>& formulas, map<string, double> *values, map<string, bool> *evaluated){
+	auto eit = evaluated->find(name);
+	if (eit != evaluated->end()){
+		return eit->second;
+	}
+	(*evaluated)[name] = false; //guards against cycles
+	auto fit = formulas.find(name);
+	if (fit == formulas.end()){
+		return false;
+	}
+	istringstream iss(fit->second);
+	string first, op, second, extra;
+	if (!(iss >> first >> op >> second) || (iss >> extra) || op.size() != 1 || string("+-*/").find(op[0]) == string::npos){
+		return false;
+	}
+	if (!evaluate(first, formulas, values, evaluated) || !evaluate(second, formulas, values, evaluated)){
+		return false;
+	}
+	double a = (*values)[first];
+	double b = (*values)[second];
+	double value;
+	if (op == "+"){
+		value = a + b;
+	} else if (op == "-"){
+		value = a - b;
+	} else if (op == "*"){
+		value = a * b;
+	} else {
+		value = a / b;
+	}
+	(*values)[name] = value;
+	(*evaluated)[name] = true;
+	return true;
+}
+
+
+int main(int argc, char * argv[]){
+
+	ArgumentContainer args("combine", false);
+	PositionalArgument<string> simPointsFile(&args, "simpoints_file", "simulation points file written by analyze", "");
+	PositionalArgument<string> statsPrefix(&args, "stats_prefix", "prefix of the statistics files of the simulation points", "");
+	OptionalArgument<string> statsSuffix(&args, "stats_suffix", "suffix of the statistics files of the simulation points", "");
+	OptionalArgument<string> outputFile(&args, "output", "name of output statistics file (empty for standard output)", "");
+
+	if (args.parse(argc, argv)){
+		args.usage(cerr);
+		return -1;
+	}
+
+	SimPointFile simPoints;
+	simPoints.read(simPointsFile.getValue());
+	const vector<SimPoint>& points = simPoints.getPoints();
+	if (points.empty()){
+		error("Simulation points file '%s' has no simulation points", simPointsFile.getValue().c_str());
+	}
+
+	vector<string> names; //in the order of the first file
+	map<string, string> descriptions;
+	map<string, string> formulas; //of the derived statistics
+	map<string, double> values;
+	map<string, unsigned> counts;
+	double totalWeight = 0.0;
+
+	for (unsigned i = 0; i < points.size(); i++){
+		ostringstream filename;
+		filename << statsPrefix.getValue() << i << statsSuffix.getValue();
+		ifstream in(filename.str().c_str());
+		if (!in.is_open()){
+			error("Could not open statistics file '%s'", filename.str().c_str());
+		}
+		totalWeight += points[i].weight;
+		string line, description, formula;
+		while (getline(in, line)){
+			if (line.empty()){
+				continue;
+			}
+			if (line.compare(0, 2, "#=") == 0){
+				formula = line.substr(2);
+				continue;
+			}
+			if (line[0] == '#'){
+				description = line;
+				formula.clear();
+				continue;
+			}
+			istringstream iss(line);
+			string name, valueString;
+			if (!(iss >> name >> valueString)){
+				continue;
+			}
+			char *end;
+			double value = strtod(valueString.c_str(), &end);
+			if (*end != '\0'){
+				continue;
+			}
+			if (counts.find(name) == counts.end()){
+				names.push_back(name);
+				descriptions[name] = description;
+				if (!formula.empty()){
+					formulas[name] = formula;
+				}
+			}
+			if (formula.empty()){
+				values[name] += points[i].weight * value;
+			}
+			counts[name]++;
+			formula.clear();
+		}
+	}
+
+	map<string, bool> evaluated; //whether each statistic could be combined
+	for (vector<string>::iterator it = names.begin(); it != names.end(); ++it){
+		if (counts[*it] != points.size()){
+			evaluated[*it] = false;
+		} else if (formulas.find(*it) == formulas.end()){
+			values[*it] /= totalWeight;
+			evaluated[*it] = true;
+		}
+	}
+	unsigned leftOut = 0;
+	for (vector<string>::iterator it = names.begin(); it != names.end(); ++it){
+		if (counts[*it] == points.size() && !evaluate(*it, formulas, &values, &evaluated)){
+			leftOut++;
+		}
+	}
+	if (leftOut != 0){
+		errno = 0;
+		warn("%u derived statistics cannot be recomputed from the combined statistics and are left out", leftOut);
+	}
+
+	ofstream file;
+	if (!outputFile.getValue().empty()){
+		file.open(outputFile.getValue().c_str());
+		if (!file.is_open()){
+			error("Could not open file '%s'", outputFile.getValue().c_str());
+		}
+	}
+	ostream& out = outputFile.getValue().empty() ? cout : file;
+	out << "#Number of simulation points combined" << endl;
+	out << "simpoints " << points.size() << endl << endl;
+	for (vector<string>::iterator it = names.begin(); it != names.end(); ++it){
+		if (counts[*it] != points.size()){
+			errno = 0;
+			warn("Statistic '%s' is not in all the statistics files", it->c_str());
+			continue;
+		}
+		if (!evaluated[*it]){
+			continue;
+		}
+		if (!descriptions[*it].empty()){
+			out << descriptions[*it] << endl;
+		}
+		auto fit = formulas.find(*it);
+		if (fit != formulas.end()){
+			out << "#=" << fit->second << endl;
+		}
+		out << *it << " " << values[*it] << endl << endl;
+	}
+
+	return 0;
+
+}
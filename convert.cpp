@@ -19,12 +19,23 @@ int main(int argc, char * argv[]){
 	PositionalArgument<string> inputFile(&args, "input_file", "input file", "");
 	PositionalArgument<string> outputPrefix(&args, "output_prefix", "output prefix", "");
 	OptionalArgument<string> compression(&args, "c", "compression algorithm (gzip|bzip2)", "gzip");
+	OptionalArgument<string> format(&args, "f", "format of the input file (addr: header line and virtual address, physical address, R or W and timestamp per line; text: output of texter)", "addr");
 
 	if (args.parse(argc, argv)){
 		args.usage(cerr);
 		return -1;
 	}
 
+	bool text;
+	if (format.getValue() == "addr"){
+		text = false;
+	} else if (format.getValue() == "text"){
+		text = true;
+	} else {
+		args.usage(cerr);
+		return -1;
+	}
+
 	CompressionType comp;
 	if (compression.getValue() == "gzip"){
 		comp = GZIP;
@@ -43,8 +54,11 @@ int main(int argc, char * argv[]){
 	char buffer[1024];
 
 
-	//skip first line
-	char * line = gzgets(reader, buffer, 1024);
+	//skip first line (the text format has no header)
+	char * line;
+	if (!text){
+		line = gzgets(reader, buffer, 1024);
+	}
 
 
 	CompressedTraceWriter writer(outputPrefix.getValue(), comp);
@@ -59,16 +73,27 @@ int main(int argc, char * argv[]){
 		} else {
 			string lineStr(line);
 			istringstream iss(lineStr);
-			uint64 vAddr;
 			char rw;
-			iss >> hex >> vAddr >> entry.address >> dec >> rw >> entry.timestamp;
-			entry.size = 4;
+			if (text){
+				uint32 size;
+				char type;
+				iss >> entry.timestamp >> entry.address >> size >> rw >> type;
+				entry.size = size;
+				entry.instr = type == 'I';
+				if (iss.fail()){
+					error("Malformed line in input file: '%s'", lineStr.c_str());
+				}
+			} else {
+				uint64 vAddr;
+				iss >> hex >> vAddr >> entry.address >> dec >> rw >> entry.timestamp;
+				entry.size = 4;
+				entry.instr = false;
+			}
 			if (rw == 'R'){
 				entry.read = true;
 			} else {
 				entry.read = false;
 			}
-			entry.instr = false;
 
 			//cout << entry.timestamp << " " <<  entry.address << "" << entry.size << " " << entry.read << " " << entry.instr << endl;
 			writer.writeEntry(&entry);
@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+/*
+ * This program converts a counter trace from the text format written by the simulator into the binary format,
+ * which the offline partition and parse read without any parsing.
+ */
+
+#include "Arguments.H"
+#include "Counter.H"
+
+
+int main(int argc, char * argv[]){
+
+	ArgumentContainer args("pack", false);
+	PositionalArgument<string> inputFile(&args, "input_file", "counter trace in text format", "");
+	PositionalArgument<string> outputFile(&args, "output_file", "counter trace in binary format", "");
+
+	if (args.parse(argc, argv)){
+		args.usage(cerr);
+		return -1;
+	}
+
+	CounterTraceReader reader(inputFile.getValue());
+	reader.writeBinary(outputFile.getValue());
+
+	return 0;
+}
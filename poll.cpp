@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+/*
+ * This program prints the telemetry snapshots served by running simulations (see the telemetry_socket option of sim),
+ * either once or periodically.
+ */
+
+#include "Arguments.H"
+#include "Error.H"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+/*
+ * Returns false if the simulation is not serving snapshots on the socket
+ */
+bool readSnapshot(const string& path, string *snapshot){
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)){
+		return false;
+	}
+	strcpy(addr.sun_path, path.c_str());
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0){
+		return false;
+	}
+	if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0){
+		close(fd);
+		return false;
+	}
+	snapshot->clear();
+	char buffer[4096];
+	ssize_t ret;
+	while ((ret = read(fd, buffer, sizeof(buffer))) > 0){
+		snapshot->append(buffer, ret);
+	}
+	close(fd);
+	return ret == 0;
+}
+
+int main(int argc, char * argv[]){
+
+	ArgumentContainer args("poll", false, true, "OTHER_SOCKETS", "telemetry sockets of other simulations");
+	PositionalArgument<string> socketPath(&args, "socket", "telemetry socket of a simulation", "");
+	OptionalArgument<unsigned> period(&args, "period", "number of seconds between polls (0 to poll once)", 0);
+
+	if (args.parse(argc, argv)){
+		args.usage(cerr);
+		return -1;
+	}
+
+	vector<string> paths(1, socketPath.getValue());
+	paths.insert(paths.end(), args.moreArgs().begin(), args.moreArgs().end());
+
+	while (true){
+		for (vector<string>::const_iterator it = paths.begin(); it != paths.end(); ++it){
+			string snapshot;
+			if (paths.size() > 1){
+				cout << "==> " << *it << " <==" << endl;
+			}
+			if (readSnapshot(*it, &snapshot)){
+				cout << snapshot;
+			} else {
+				cout << "state unavailable" << endl;
+			}
+		}
+		if (period.getValue() == 0){
+			break;
+		}
+		cout << endl;
+		sleep(period.getValue());
+	}
+
+	return 0;
+}
@@ -7,16 +7,22 @@
 #include "Arguments.H"
 #include "Bank.H"
 #include "Cache.H"
+#include "Checkpoint.H"
 #include "CPU.H"
 #include "Engine.H"
 #include "Error.H"
+#include "EventLog.H"
 #include "HybridMemory.H"
 #include "Memory.H"
 #include "MemoryHierarchy.H"
 #include "MemoryManager.H"
 #include "Migration.H"
 #include "Partition.H"
+#include "Profiler.H"
+#include "Sampler.H"
+#include "SimPoint.H"
 #include "Statistics.H"
+#include "Telemetry.H"
 #include "TraceHandler.H"
 #include "Types.H"
 
@@ -49,12 +55,26 @@ int main(int argc, char * argv[]){
 
 	OptionalArgument<uint64> intervalStatsPeriod(&args, "interval_stats_period", "period use by the engine to print interval statistics (0 for no interval statistics)", 0);
 	OptionalArgument<string> intervalStatsFile(&args, "interval_stats_file", "name of interval statistics file (empty for no interval statistics", "");
+	OptionalArgument<string> intervalStatsFormat(&args, "interval_stats_format", "format of interval statistics file (text, binary or compressed)", "text");
 
 	OptionalArgument<string> tracePrefix(&args, "trace_prefix", "prefix of trace files", "");
 	OptionalArgument<string> counterTracePrefix(&args, "counter_trace_prefix", "prefix of the file where the counter trace is read from", "");
 	OptionalArgument<string> counterTraceInfix(&args, "counter_trace_infix", "infix (after prefix and after conf but before name of trace) of the file where the counter trace is read from", "");
 
-	OptionalArgument<uint64> stop(&args, "stop", "timestamp to stop execution of the simulator (0 means don't stop)", 0);
+	OptionalArgument<uint64> stop(&args, "stop", "timestamp to stop execution of the simulator (0 means don't stop; with checkpoint_out, the cores stop fetching instructions at this timestamp and the simulation ends once they finish)", 0);
+
+	OptionalArgument<string> checkpointOut(&args, "checkpoint_out", "name of the file where the state of the simulator is saved at the end of the simulation (empty for no checkpoint)", "");
+	OptionalArgument<string> restoreFile(&args, "restore", "name of the checkpoint file the state of the simulator is restored from (empty to start cold)", "");
+	OptionalArgument<uint64> fastForward(&args, "fast_forward", "number of instructions of each core that are skipped before the simulation starts", 0);
+	OptionalArgument<uint64> warmup(&args, "warmup", "number of instructions of each core (after the ones skipped) used to warm up the caches and the placement of pages without simulating timing", 0);
+	OptionalArgument<string> simPointsFile(&args, "simpoints", "name of the simulation points file written by analyze (empty to simulate from the start of the trace)", "");
+	OptionalArgument<unsigned> simPoint(&args, "simpoint", "index of the simulation point to simulate (sets fast_forward and instr_limit; the warmup comes out of the instructions skipped)", 0);
+	OptionalArgument<uint64> sampleFunctional(&args, "sample_functional", "number of instructions of each core that are functionally simulated between sampling windows (0 to simulate every instruction in detail)", 0);
+	OptionalArgument<uint64> sampleDetailedWarmup(&args, "sample_detailed_warmup", "number of instructions simulated in detail before each sampling window is measured", 2000);
+	OptionalArgument<uint64> sampleWindow(&args, "sample_window", "number of instructions measured in each sampling window", 1000);
+	OptionalArgument<double> sampleTargetError(&args, "sample_target_error", "half width of the confidence interval of the IPC (relative to its mean) at which a sampled core stops", 0.03);
+	OptionalArgument<double> sampleConfidence(&args, "sample_confidence", "confidence level of the sampling confidence intervals", 0.997);
+	OptionalArgument<unsigned> sampleMinWindows(&args, "sample_min_windows", "minimum number of sampling windows measured before a sampled core can stop", 30);
 
 	OptionalArgument<uint64> debugStart(&args, "debug", "timestamp to start debugging output ", numeric_limits<uint64>::max());
 	OptionalArgument<uint64> debugCpuStart(&args, "debug_cpu", "timestamp to start debugging output for the CPUs", numeric_limits<uint64>::max());
@@ -64,6 +84,14 @@ int main(int argc, char * argv[]){
 	OptionalArgument<uint64> debugCachesHybridStart(&args, "debug_caches_hybrid", "timestamp to start debugging output for the caches, hybrid memory and hybrid memory manager", numeric_limits<uint64>::max());
 
 	OptionalArgument<uint64> progressPeriod(&args, "progress_period", "period use by the engine to print progress information (0 for no information)", 10000000);
+	OptionalArgument<uint64> profilePeriod(&args, "profile_period", "number of events per event timed by the profiler of the event handlers (0 for no profiling)", 0);
+	OptionalArgument<string> telemetrySocket(&args, "telemetry_socket", "path of the Unix domain socket where snapshots of the running simulation are served (empty for no telemetry)", "");
+	OptionalArgument<uint64> telemetryPeriod(&args, "telemetry_period", "period used by the engine to update the telemetry snapshot", 1000000);
+	OptionalArgument<string> telemetryStats(&args, "telemetry_stats", "comma separated names of the statistics in the telemetry snapshot (a trailing * selects every statistic with the prefix; missing statistics are skipped)", "dram_queue_size,pcm_queue_size,manager_dram_migrations,manager_pcm_migrations");
+	OptionalArgument<string> eventLogFile(&args, "event_log", "binary file where the spans of memory requests and migrations are logged for the timeline program (empty for no event log)", "");
+	OptionalArgument<uint64> eventLogStart(&args, "event_log_start", "timestamp of the first cycle of the event log window", 0);
+	OptionalArgument<uint64> eventLogEnd(&args, "event_log_end", "timestamp of the cycle after the event log window", numeric_limits<uint64>::max());
+	OptionalArgument<uint64> eventLogBuffer(&args, "event_log_buffer", "number of records in the ring buffer of the event log (must be a power of 2)", 65536);
 
 	OptionalArgument<unsigned> blockSize(&args, "block_size", "block size", 64);
 	OptionalArgument<unsigned> pageSize(&args, "page_size", "page size", 4096);
@@ -133,7 +161,7 @@ int main(int argc, char * argv[]){
 	OptionalArgument<string> migrationPolicy(&args, "migration_policy", "migration policy (no_migration|multi_queue|first_touch|double_clock|frequency|offline)", "multi_queue");
 	OptionalArgument<AllocationPolicy> allocationPolicy(&args, "allocation_policy", "allocation policy (dram_first|pcm_only|custom)", DRAM_FIRST);
 	OptionalArgument<string> customAllocator(&args, "custom_allocator", "custom allocator (offline_frequency)", "offline_frequency");
-	OptionalArgument<string> partitionPolicy(&args, "partition_policy", "partition policy (none|static|offline)", "none");
+	OptionalArgument<string> partitionPolicy(&args, "partition_policy", "partition policy (none|static|offline|dynamic|utility)", "none");
 
 	//Arguments for the offline migration policy
 	OptionalArgument<string> metricType(&args, "metric_type", "metric type (accessed|access_count|touch_count)", "access_count");
@@ -168,6 +196,10 @@ int main(int argc, char * argv[]){
 	OptionalArgument<uint64> spaceGran(&args, "space_granularity", "granularity of rate allocation", 8);
 	OptionalArgument<double> IPCconstraint(&args, "ipc_constraint", "IPC constraint of the low priority application", 0.1975842);
 
+	//Arguments for utility partition policy
+	OptionalArgument<unsigned> utilityUnits(&args, "utility_units", "number of units in which DRAM is allocated", 64);
+	OptionalArgument<uint64> utilitySampledSets(&args, "utility_sampled_sets", "number of sets of the shadow tags that are sampled", 32);
+
 	//Arguments for very old migration policy
 	OptionalArgument<MonitoringStrategy> monitoringStrategy(&args, "monitoring_strategy", "monitoring_strategy (no_pam|pam)", NO_PAM);
 	OptionalArgument<QueuePolicy> promotionPolicy(&args, "promotion_policy", "promotion policy (fifo|lru|freq)", FREQ);
@@ -189,6 +221,15 @@ int main(int argc, char * argv[]){
 	OptionalArgument<bool> elideCleanDramBlocks(&args, "elide_clean_dram_blocks", "whether to elide copying of clean DRAM block for page migrations from DRAM to PCM", false);
 	OptionalArgument<bool> fixedPcmMigrationCost(&args, "fixed_pcm_migration_cost", "whether the hybrid memory uses a fixed migration cost for page migrations from DRAM to PCM", false);
 	OptionalArgument<uint64> pcmMigrationCost(&args, "pcm_migration_cost", "PCM migration cost", 1200);
+	OptionalArgument<unsigned> migrationSectorSize(&args, "migration_sector_size", "size in bytes of the sectors that are migrated independently (0 to migrate whole pages)", 0);
+	OptionalArgument<unsigned> copyMaxReads(&args, "copy_max_reads", "maximum number of block reads of page copies in flight (0 for no limit)", 0);
+	OptionalArgument<unsigned> copyMaxWrites(&args, "copy_max_writes", "maximum number of copied blocks waiting to be written to their destination (0 for no limit)", 0);
+	OptionalArgument<string> monitorType(&args, "monitor_type", "type of access monitor (full|sampled|sketch|cam)", "full");
+	OptionalArgument<unsigned> monitorSamplingPeriod(&args, "monitor_sampling_period", "number of accesses per sampled access for the sampled monitor", 16);
+	OptionalArgument<unsigned> monitorSketchWidth(&args, "monitor_sketch_width", "number of counters per row of the sketch monitor (power of 2)", 4096);
+	OptionalArgument<unsigned> monitorSketchDepth(&args, "monitor_sketch_depth", "number of rows of the sketch monitor", 4);
+	OptionalArgument<uint64> monitorSketchThreshold(&args, "monitor_sketch_threshold", "estimated number of accesses after which the sketch monitor tracks a page", 4);
+	OptionalArgument<unsigned> monitorCamEntries(&args, "monitor_cam_entries", "number of entries of the cam monitor", 256);
 
 	//Arguments for Old hHybrid memory
 	OptionalArgument<bool> burstMigration(&args, "burst_migration", "whether the hybrid memory issues requests for page migration in a burst", true);
@@ -258,6 +299,23 @@ int main(int argc, char * argv[]){
 		debugHybridMemoryManagerStart.setValue(debugStart.getValue());
 	}
 
+	if (!simPointsFile.getValue().empty()){
+		if (fastForward.isSet() || instrLimit.isSet()){
+			error("fast_forward and instr_limit cannot be set when simulating a simulation point");
+		}
+		SimPointFile simPoints;
+		simPoints.read(simPointsFile.getValue());
+		if (simPoint.getValue() >= simPoints.getPoints().size()){
+			error("Simulation point %u does not exist (the file has %lu)", simPoint.getValue(), simPoints.getPoints().size());
+		}
+		uint64 start = simPoints.getPoints()[simPoint.getValue()].interval * simPoints.getPeriod();
+		if (warmup.getValue() > start){
+			warmup.setValue(start);
+		}
+		fastForward.setValue(start - warmup.getValue());
+		instrLimit.setValue(simPoints.getPeriod());
+	}
+
 	unsigned numCores;
 	unsigned numProcesses;
 	vector<string> traceNames;
@@ -289,12 +347,27 @@ int main(int argc, char * argv[]){
 
 
 	StatContainer stats;
-	Engine engine(&stats, intervalStatsPeriod.getValue(), intervalStatsFile.getValue(), progressPeriod.getValue());
+	TelemetryServer *telemetry = 0;
+	if (!telemetrySocket.getValue().empty()){
+		telemetry = new TelemetryServer(telemetrySocket.getValue(), &stats, telemetryStats.getValue());
+	}
+	Engine engine(&stats, intervalStatsPeriod.getValue(), intervalStatsFile.getValue(), intervalStatsFormat.getValue(), progressPeriod.getValue(), telemetry, telemetryPeriod.getValue());
+	Profiler *profiler = 0;
+	if (profilePeriod.getValue() != 0){
+		profiler = new Profiler(profilePeriod.getValue());
+		engine.setProfiler(profiler);
+	}
+	EventLog *eventLog = 0;
+	if (!eventLogFile.getValue().empty()){
+		eventLog = new EventLog(eventLogFile.getValue(), eventLogStart.getValue(), eventLogEnd.getValue(), eventLogBuffer.getValue());
+		engine.setEventLog(eventLog);
+	}
 	Memory *dramMemory = 0;
 	Memory *pcmMemory = 0;
 	IMemory *memory = 0;
 	CacheMemory *cacheMemory = 0;
 	HybridMemory *hybridMemory = 0;
+	IAccessMonitor *monitor = 0;
 	OldHybridMemory *oldHybridMemory = 0;
 	Cache *sharedL2 = 0;
 	vector<IMigrationPolicy*> policies;
@@ -321,7 +394,18 @@ int main(int argc, char * argv[]){
 	} else if (memoryOrganization.getValue() == "hybrid"){
 		dramMemory = new Memory("dram", "DRAM", &engine, &stats, debugStart.getValue(), DRAM_QUEUE, DRAM_OPEN, DRAM_ACCESS, DRAM_CLOSE, DRAM_BUS_QUEUE, DRAM_BUS, dramRowBufferPolicy.getValue(), DESTRUCTIVE_READS, dramMappingType.getValue(), dramGlobalQueue.getValue(), dramQueueSize.getValue(), dramRanks.getValue(), dramBanksPerRank.getValue(), dramRowsPerBank.getValue(), dramBlocksPerRow.getValue(), blockSize.getValue(), dramOpenLatency.getValue(), dramCloseLatency.getValue(), dramAccessLatency.getValue(), false, dramBusLatency.getValue(),0);
 		pcmMemory = new Memory("pcm", "PCM", &engine, &stats, debugStart.getValue(), PCM_QUEUE, PCM_OPEN, PCM_ACCESS, PCM_CLOSE, PCM_BUS_QUEUE, PCM_BUS, pcmRowBufferPolicy.getValue(), NON_DESTRUCTIVE_READS, pcmMappingType.getValue(), pcmGlobalQueue.getValue(), pcmQueueSize.getValue(), pcmRanks.getValue(), pcmBanksPerRank.getValue(), pcmRowsPerBank.getValue(), pcmBlocksPerRow.getValue(), blockSize.getValue(), pcmOpenLatency.getValue(), pcmCloseLatency.getValue(), pcmAccessLatency.getValue(), pcmLongLatency.getValue(), pcmBusLatency.getValue(), dramMemory->getSize());
-		hybridMemory = new HybridMemory("hybrid_memory", "Hybrid Memory", &engine, &stats, debugHybridMemoryStart.getValue(), numProcesses, dramMemory, pcmMemory, blockSize.getValue(), pageSize.getValue(), dramMigrationReadDelay.getValue(), dramMigrationWriteDelay.getValue(), pcmMigrationReadDelay.getValue(), pcmMigrationWriteDelay.getValue(), completionThreshold.getValue(), elideCleanDramBlocks.getValue(), fixedPcmMigrationCost.getValue(), pcmMigrationCost.getValue());
+		if (monitorType.getValue() == "full"){
+			monitor = new FullAccessMonitor("hybrid_memory_monitor", "Hybrid Memory Monitor", &stats);
+		} else if (monitorType.getValue() == "sampled"){
+			monitor = new SampledAccessMonitor("hybrid_memory_monitor", "Hybrid Memory Monitor", &stats, monitorSamplingPeriod.getValue());
+		} else if (monitorType.getValue() == "sketch"){
+			monitor = new SketchAccessMonitor("hybrid_memory_monitor", "Hybrid Memory Monitor", &stats, monitorSketchWidth.getValue(), monitorSketchDepth.getValue(), monitorSketchThreshold.getValue());
+		} else if (monitorType.getValue() == "cam"){
+			monitor = new CamAccessMonitor("hybrid_memory_monitor", "Hybrid Memory Monitor", &stats, monitorCamEntries.getValue());
+		} else {
+			error("Invalid monitor type: %s", monitorType.getValue().c_str());
+		}
+		hybridMemory = new HybridMemory("hybrid_memory", "Hybrid Memory", &engine, &stats, debugHybridMemoryStart.getValue(), numProcesses, dramMemory, pcmMemory, blockSize.getValue(), pageSize.getValue(), dramMigrationReadDelay.getValue(), dramMigrationWriteDelay.getValue(), pcmMigrationReadDelay.getValue(), pcmMigrationWriteDelay.getValue(), completionThreshold.getValue(), elideCleanDramBlocks.getValue(), fixedPcmMigrationCost.getValue(), pcmMigrationCost.getValue(), migrationSectorSize.getValue(), copyMaxReads.getValue(), copyMaxWrites.getValue(), monitor);
 		memory = hybridMemory;
 	} else if (memoryOrganization.getValue() == "old_hybrid"){
 		dramMemory = new Memory("dram", "DRAM", &engine, &stats, debugStart.getValue(), DRAM_QUEUE, DRAM_OPEN, DRAM_ACCESS, DRAM_CLOSE, DRAM_BUS_QUEUE, DRAM_BUS, dramRowBufferPolicy.getValue(), DESTRUCTIVE_READS, dramMappingType.getValue(), dramGlobalQueue.getValue(), dramQueueSize.getValue(), dramRanks.getValue(), dramBanksPerRank.getValue(), dramRowsPerBank.getValue(), dramBlocksPerRow.getValue(), blockSize.getValue(), dramOpenLatency.getValue(), dramCloseLatency.getValue(), dramAccessLatency.getValue(), false, dramBusLatency.getValue(),0);
@@ -355,6 +439,9 @@ int main(int argc, char * argv[]){
 		} else if (partitionPolicy.getValue() == "dynamic"){
 			pidsPerPolicy = 1;
 			partition = new DynamicPartition(numProcesses, pageSize.getValue(), dramMemory->getSize(), rateGran.getValue(), spaceGran.getValue(), IPCconstraint.getValue());
+		} else if (partitionPolicy.getValue() == "utility"){
+			pidsPerPolicy = 1;
+			partition = new UtilityPartition(numProcesses, pageSize.getValue(), dramMemory->getSize(), dramFractions.getValue(), rateFractions.getValue(), utilityUnits.getValue(), utilitySampledSets.getValue());
 		} else {
 			args.usage(cerr);
 			return -1;
@@ -403,6 +490,9 @@ int main(int argc, char * argv[]){
 		} else if (partitionPolicy.getValue() == "dynamic"){
 			pidsPerPolicy = 1;
 			partition = new DynamicPartition(numProcesses, pageSize.getValue(), dramMemory->getSize(), rateGran.getValue(), spaceGran.getValue(), IPCconstraint.getValue());
+		} else if (partitionPolicy.getValue() == "utility"){
+			pidsPerPolicy = 1;
+			partition = new UtilityPartition(numProcesses, pageSize.getValue(), dramMemory->getSize(), dramFractions.getValue(), rateFractions.getValue(), utilityUnits.getValue(), utilitySampledSets.getValue());
 		} else {
 			args.usage(cerr);
 			return -1;
@@ -447,6 +537,7 @@ int main(int argc, char * argv[]){
 	map<unsigned, Cache*> dataL1s;
 	map<unsigned, TraceReaderBase*> readers;
 	map<unsigned, CPU*> cpus;
+	map<unsigned, Sampler*> samplers;
 
 	for (unsigned i = 0; i < numCores; i++){
 		if (useCaches.getValue()){
@@ -473,7 +564,11 @@ int main(int argc, char * argv[]){
 		} else {
 			cpus[i] = new OOOCPU(&engine, ossName3.str(), ossDesc3.str(), debugCpuStart.getValue(), &stats, i, pid, manager, memory, memory, readers[i], blockSize.getValue(), instrLimit.getValue(), robSize.getValue(), issueWidth.getValue());
 		}
-		cpus[i]->start();
+
+		if (sampleFunctional.getValue() != 0){
+			samplers[i] = new Sampler(&engine, ossName3.str(), ossDesc3.str(), &stats, sampleFunctional.getValue(), sampleDetailedWarmup.getValue(), sampleWindow.getValue(), sampleTargetError.getValue(), sampleConfidence.getValue(), sampleMinWindows.getValue());
+			cpus[i]->setSampler(samplers[i]);
+		}
 	}
 
 	//Add counters to hybrid memory manager
@@ -506,29 +601,117 @@ int main(int argc, char * argv[]){
 
 	manager->allocate(allocationNames);
 
+	Checkpointer checkpointer;
+	if (!checkpointOut.getValue().empty() || !restoreFile.getValue().empty()){
+		ICheckpointable *checkpointableManager = dynamic_cast<ICheckpointable*>(manager);
+		if (checkpointableManager == 0){
+			error("Checkpoints are not supported with the %s memory organization", memoryOrganization.getValue().c_str());
+		}
+		checkpointer.add("engine", &engine);
+		if (dramMemory != 0){
+			checkpointer.add("dram", dramMemory);
+		}
+		if (pcmMemory != 0){
+			checkpointer.add("pcm", pcmMemory);
+		}
+		if (sharedL2 != 0){
+			checkpointer.add(sharedL2->getName(), sharedL2);
+		}
+		for (unsigned i = 0; i < numCores; i++){
+			if (useCaches.getValue()){
+				checkpointer.add(instrL1s[i]->getName(), instrL1s[i]);
+				checkpointer.add(dataL1s[i]->getName(), dataL1s[i]);
+			}
+			checkpointer.add(cpus[i]->getName(), cpus[i]);
+		}
+		checkpointer.add("manager", checkpointableManager);
+		for (unsigned i = 0; i < policies.size(); i++){
+			ostringstream ossName;
+			ossName << "policy_" << i;
+			checkpointer.add(ossName.str(), policies[i]);
+		}
+		checkpointer.add("stats", &stats);
+	}
+
+	if (!restoreFile.getValue().empty()){
+		checkpointer.restore(restoreFile.getValue());
+	}
+
+	for (unsigned i = 0; i < numCores; i++){
+		cpus[i]->skipInstructions(fastForward.getValue());
+	}
+	//the cores take turns so that they share the caches and the memory as they do during the simulation
+	for (uint64 n = 0; n < warmup.getValue(); n++){
+		for (unsigned i = 0; i < numCores; i++){
+			cpus[i]->warmUp(1);
+		}
+	}
+
+	for (unsigned i = 0; i < numCores; i++){
+		cpus[i]->start();
+	}
 
+	//ends the simulation through Engine::run, so that the statistics, interval statistics and event log are written
 	class Exit : public IEventHandler{
+		Engine *engine;
+	public:
+		Exit(Engine *engineArg) : engine(engineArg) {}
 		void process(const Event * event) {
 			cout << event->getTimestamp() << ": exiting due to stop event" << endl;
-			exit(0);
+			engine->quit();
+		}
+	};
+
+	//a checkpoint can only be taken once the requests in flight complete, so the cores stop fetching and the simulation ends when they finish
+	class StopFetching : public IEventHandler{
+		map<unsigned, CPU*> *cpus;
+	public:
+		StopFetching(map<unsigned, CPU*> *cpusArg) : cpus(cpusArg) {}
+		void process(const Event * event) {
+			cout << event->getTimestamp() << ": draining due to stop event" << endl;
+			for (auto it = cpus->begin(); it != cpus->end(); ++it){
+				it->second->stopFetching();
+			}
 		}
 	};
 
 	if(stop.getValue() != 0){
-		engine.addEvent(stop.getValue(), new Exit(), 0);
+		if (stop.getValue() <= engine.getTimestamp()){
+			error("The stop timestamp (%lu) must be later than the restored timestamp (%lu)", stop.getValue(), engine.getTimestamp());
+		}
+		IEventHandler *stopHandler;
+		if (checkpointOut.getValue().empty()){
+			stopHandler = new Exit(&engine);
+		} else {
+			stopHandler = new StopFetching(&cpus);
+		}
+		engine.addEvent(stop.getValue() - engine.getTimestamp(), stopHandler, 0);
 	}
 
 	engine.run();
 
 	if (statsFile.getValue().empty()){
 		stats.print(cout);
+		if (profiler != 0){
+			profiler->print(cout);
+		}
 	} else {
 		ofstream out(statsFile.getValue().c_str());
 		stats.print(out);
+		if (profiler != 0){
+			profiler->print(out);
+		}
 		out.close();
 	}
 
+	if (!checkpointOut.getValue().empty()){
+		checkpointer.save(checkpointOut.getValue());
+	}
+
 	delete manager;
+	delete telemetry;
+	delete profiler;
+	delete eventLog;
 
 	return 0;
 }
@@ -0,0 +1,176 @@
+#
+# Copyright (c) 2015 Santiago Bock
+#
+# See the file LICENSE.txt for copying permission.
+#
+
+##############################################################
+#
+# Standalone build of the applications (everything except the
+# Pin tool), which does not need Pin to be installed:
+#
+#   make -f standalone.mk                  release build in build/release/
+#   make -f standalone.mk BUILD=debug      debug build in build/debug/
+#   make -f standalone.mk BUILD=debug DEBUG_LEVEL=1
+#                                          debug build with debug() but not debug2() compiled in
+#   make -f standalone.mk LTO=1            release build with link time optimization in build/release-lto/
+#   make -f standalone.mk pgo              profile guided build in build/pgo/
+#   make -f standalone.mk bench            benchmark suite (see bench.cpp)
+#   make -f standalone.mk clean
+#
+# The pgo target builds instrumented applications, runs sim on
+# the training trace and rebuilds the applications with the
+# resulting profile (and link time optimization). By default,
+# the training trace is converted from texted.txt.
+#
+##############################################################
+
+# Build type: release (optimized, assertions and debugging output compiled out) or debug
+BUILD ?= release
+
+# Debugging output compiled in (0: none, 1: debug(), 2: debug() and debug2()), by default all of it in debug builds
+# and none in release builds (clean the build directory after changing it)
+ifeq ($(BUILD),debug)
+DEBUG_LEVEL ?= 2
+else
+DEBUG_LEVEL ?= 0
+endif
+
+# Link time optimization
+LTO ?= 0
+
+# Flags for the target machine (e.g., -march=native if the binaries are only run on the machine that builds them)
+ARCH_FLAGS ?=
+
+# Training run for the pgo target (configuration file, trace prefix, trace name and extra arguments of sim); the
+# default trace is converted from texted.txt
+TRAIN_CONFIG ?= train.config
+TRAIN_PREFIX ?= $(OBJDIR)training/
+TRAIN_TRACE ?= texted
+TRAIN_ARGS ?=
+
+# Benchmark suite (baseline report, empty for no comparison, and extra arguments of bench)
+BENCH_BASELINE ?= bench/baseline
+BENCH_ARGS ?=
+
+# Internal: profile guided optimization phase (generate or use), set by the pgo target
+PGO ?=
+
+##############################################################
+#
+# Variable definition
+#
+##############################################################
+
+ifeq ($(BUILD),release)
+BUILD_FLAGS = -O3 -DNDEBUG -DDEBUG_LEVEL=$(DEBUG_LEVEL)
+else ifeq ($(BUILD),debug)
+BUILD_FLAGS = -O0 -DDEBUG_LEVEL=$(DEBUG_LEVEL)
+else
+$(error BUILD must be release or debug)
+endif
+
+ifneq ($(PGO),)
+OBJDIR = build/pgo/
+LTO = 1
+else ifeq ($(LTO),1)
+OBJDIR = build/$(BUILD)-lto/
+else
+OBJDIR = build/$(BUILD)/
+endif
+
+ifeq ($(LTO),1)
+LTO_FLAGS = -flto=auto
+endif
+
+ifeq ($(PGO),generate)
+PGO_FLAGS = -fprofile-generate -fprofile-update=atomic
+else ifeq ($(PGO),use)
+PGO_FLAGS = -fprofile-use -fprofile-correction -Wno-missing-profile
+endif
+
+CXXFLAGS = -MMD -D_FILE_OFFSET_BITS=64 -std=c++11 -Wall -Werror -iquoteinclude -g $(BUILD_FLAGS) $(ARCH_FLAGS) $(LTO_FLAGS) $(PGO_FLAGS)
+LDFLAGS = $(BUILD_FLAGS) $(ARCH_FLAGS) $(LTO_FLAGS) $(PGO_FLAGS)
+LIBS = -lbz2 -lz -lpthread
+
+APP_ROOTS = analyze bench combine convert merge pack parse poll sim split tabulate texter timeline
+
+APPS = $(APP_ROOTS:%=$(OBJDIR)%)
+
+SELF = $(firstword $(MAKEFILE_LIST))
+
+##############################################################
+#
+# build rules
+#
+##############################################################
+
+# Build the applications
+all: $(APPS)
+
+.PHONY: all pgo train bench clean
+
+# Include generated dependencies
+-include $(OBJDIR)*.d
+
+# Create the output directory
+$(OBJDIR):
+	mkdir -p $(OBJDIR)
+
+# Compile object files
+$(OBJDIR)%.o: %.cpp | $(OBJDIR)
+	$(CXX) $(CXXFLAGS) -c -o $@ $<
+
+# Link applications
+$(APPS): % : %.o
+	$(CXX) $(LDFLAGS) -o $@ $^ $(LIBS)
+
+# Dependencies for object linking
+$(OBJDIR)analyze: $(OBJDIR)analyze.o $(OBJDIR)Arguments.o $(OBJDIR)Cache.o $(OBJDIR)Checkpoint.o $(OBJDIR)Engine.o $(OBJDIR)Error.o $(OBJDIR)EventLog.o $(OBJDIR)Profiler.o $(OBJDIR)SimPoint.o $(OBJDIR)StackDistance.o $(OBJDIR)Statistics.o $(OBJDIR)Telemetry.o $(OBJDIR)TraceHandler.o
+$(OBJDIR)bench: $(OBJDIR)bench.o $(OBJDIR)Arguments.o $(OBJDIR)Error.o
+$(OBJDIR)combine: $(OBJDIR)combine.o $(OBJDIR)Arguments.o $(OBJDIR)Error.o $(OBJDIR)SimPoint.o
+$(OBJDIR)convert: $(OBJDIR)convert.o $(OBJDIR)Arguments.o $(OBJDIR)Error.o $(OBJDIR)TraceHandler.o
+$(OBJDIR)merge: $(OBJDIR)merge.o $(OBJDIR)Arguments.o $(OBJDIR)Error.o $(OBJDIR)TraceHandler.o
+$(OBJDIR)pack: $(OBJDIR)pack.o $(OBJDIR)Arguments.o $(OBJDIR)Checkpoint.o $(OBJDIR)Error.o $(OBJDIR)Counter.o
+$(OBJDIR)parse: $(OBJDIR)parse.o $(OBJDIR)Arguments.o $(OBJDIR)Checkpoint.o $(OBJDIR)Error.o $(OBJDIR)Counter.o
+$(OBJDIR)poll: $(OBJDIR)poll.o $(OBJDIR)Arguments.o $(OBJDIR)Error.o
+$(OBJDIR)sim: $(OBJDIR)sim.o $(OBJDIR)Arguments.o $(OBJDIR)Bank.o $(OBJDIR)Bus.o $(OBJDIR)Cache.o $(OBJDIR)Checkpoint.o $(OBJDIR)Counter.o $(OBJDIR)CPU.o $(OBJDIR)Engine.o $(OBJDIR)Error.o $(OBJDIR)EventLog.o $(OBJDIR)HybridMemory.o $(OBJDIR)Memory.o $(OBJDIR)MemoryManager.o $(OBJDIR)Migration.o $(OBJDIR)Monitor.o $(OBJDIR)Partition.o $(OBJDIR)Profiler.o $(OBJDIR)Sampler.o $(OBJDIR)SimPoint.o $(OBJDIR)Statistics.o $(OBJDIR)Telemetry.o $(OBJDIR)TraceHandler.o
+$(OBJDIR)split: $(OBJDIR)split.o $(OBJDIR)Arguments.o $(OBJDIR)Error.o $(OBJDIR)TraceHandler.o
+$(OBJDIR)tabulate: $(OBJDIR)tabulate.o $(OBJDIR)Arguments.o $(OBJDIR)Checkpoint.o $(OBJDIR)Error.o $(OBJDIR)Statistics.o
+$(OBJDIR)texter: $(OBJDIR)texter.o $(OBJDIR)Arguments.o $(OBJDIR)Error.o $(OBJDIR)TraceHandler.o
+$(OBJDIR)timeline: $(OBJDIR)timeline.o $(OBJDIR)Arguments.o $(OBJDIR)Error.o $(OBJDIR)EventLog.o
+
+# Profile guided build: both phases use the same object directory, so that the profile of each object file is found
+# next to it when it is recompiled
+pgo:
+	rm -rf build/pgo
+	$(MAKE) -f $(SELF) PGO=generate
+	$(MAKE) -f $(SELF) PGO=generate train
+	rm -f build/pgo/*.o $(APP_ROOTS:%=build/pgo/%)
+	$(MAKE) -f $(SELF) PGO=use
+
+# Default training trace
+TRAIN_DEFAULT = $(OBJDIR)training/texted-instr-time.gz
+
+$(TRAIN_DEFAULT): texted.txt $(OBJDIR)convert
+	mkdir -p $(OBJDIR)training
+	$(OBJDIR)convert -f text texted.txt $(OBJDIR)training/texted
+
+# Run sim on the training trace (converting the default one first if it is used)
+train: $(OBJDIR)sim $(filter $(TRAIN_DEFAULT),$(TRAIN_PREFIX)$(TRAIN_TRACE)-instr-time.gz)
+	@for f in instr read write; do for s in time addr size; do \
+		if [ ! -f $(TRAIN_PREFIX)$(TRAIN_TRACE)-$$f-$$s.gz ]; then \
+			echo "Training trace file $(TRAIN_PREFIX)$(TRAIN_TRACE)-$$f-$$s.gz is missing (set TRAIN_PREFIX and TRAIN_TRACE to a complete trace)"; exit 1; \
+		fi; \
+	done; done
+	$(OBJDIR)sim $(TRAIN_CONFIG) $(TRAIN_TRACE) -trace_prefix $(TRAIN_PREFIX) -progress_period 0 -stats $(OBJDIR)train.stats $(TRAIN_ARGS) > /dev/null
+
+# Run the benchmark suite on the reference trace (converted from texted.txt) and compare the report against the baseline
+bench: $(OBJDIR)bench $(OBJDIR)convert $(OBJDIR)sim
+	mkdir -p $(OBJDIR)benchmark
+	$(OBJDIR)convert -f text texted.txt $(OBJDIR)benchmark/texted
+	$(OBJDIR)bench $(OBJDIR)sim bench/matrix $(OBJDIR)benchmark/report -trace texted -trace_prefix $(OBJDIR)benchmark/ $(if $(BENCH_BASELINE),-baseline $(BENCH_BASELINE)) $(BENCH_ARGS)
+
+# Cleaning
+clean:
+	rm -rf build
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+/*
+ * This program converts a binary interval statistics file written by the simulator into CSV, with one row per interval
+ * and one column per statistic.
+ */
+
+#include "Arguments.H"
+#include "Statistics.H"
+
+
+int main(int argc, char * argv[]){
+
+	ArgumentContainer args("tabulate", false);
+	PositionalArgument<string> inputFile(&args, "input_file", "interval statistics file in binary format", "");
+	PositionalArgument<string> outputFile(&args, "output_file", "interval statistics file in CSV format", "");
+	OptionalArgument<unsigned> precision(&args, "precision", "number of decimal places of floating point statistics", 2);
+
+	if (args.parse(argc, argv)){
+		args.usage(cerr);
+		return -1;
+	}
+
+	IntervalStatsReader reader(inputFile.getValue());
+	const vector<pair<string, StatType> >& columns = reader.getColumns();
+
+	ofstream out(outputFile.getValue().c_str());
+	if (!out.is_open()){
+		error("Could not open output file '%s'", outputFile.getValue().c_str());
+	}
+	out.setf(std::ios::fixed);
+	out.precision(precision.getValue());
+
+	for (unsigned c = 0; c < columns.size(); c++){
+		out << (c == 0 ? "" : ",") << columns[c].first;
+	}
+	out << '\n';
+
+	vector<uint64> cells;
+	uint64 numRows;
+	while (reader.readGroup(&cells, &numRows)){
+		for (uint64 r = 0; r < numRows; r++){
+			for (unsigned c = 0; c < columns.size(); c++){
+				const uint64 *cell = &cells[c * numRows + r];
+				if (c != 0){
+					out << ',';
+				}
+				if (columns[c].second == STAT_DOUBLE){
+					out << *reinterpret_cast<const double *>(cell);
+				} else {
+					out << *cell;
+				}
+			}
+			out << '\n';
+		}
+	}
+
+	out.close();
+	if (out.fail()){
+		error("Error writing output file '%s'", outputFile.getValue().c_str());
+	}
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2015 Santiago Bock
+ *
+ * See the file LICENSE.txt for copying permission.
+ */
+
+/*
+ * This program converts an event log written by the simulator (see the event_log option of sim) into the JSON trace
+ * event format read by Perfetto (ui.perfetto.dev) and chrome://tracing. Every track of the log (a CPU, a cache, a bank,
+ * a bus or the memory manager) becomes a process of the trace, and every span becomes an asynchronous slice, so that
+ * overlapping requests and migrations are laid out in separate rows.
+ */
+
+#include "Arguments.H"
+#include "Error.H"
+#include "EventLog.H"
+
+#include <iomanip>
+#include <limits>
+
+void writeString(ostream& out, const string& str){
+	out << '"';
+	for (string::const_iterator it = str.begin(); it != str.end(); ++it){
+		if (*it == '"' || *it == '\\'){
+			out << '\\';
+		}
+		out << *it;
+	}
+	out << '"';
+}
+
+int main(int argc, char * argv[]){
+
+	ArgumentContainer args("timeline", false);
+	PositionalArgument<string> inputFile(&args, "input_file", "event log written by the simulator", "");
+	PositionalArgument<string> outputFile(&args, "output_file", "trace in JSON trace event format", "");
+	OptionalArgument<uint64> start(&args, "start", "timestamp of the first cycle of the window to convert", 0);
+	OptionalArgument<uint64> end(&args, "end", "timestamp of the cycle after the window to convert", numeric_limits<uint64>::max());
+	OptionalArgument<double> cyclesPerMicrosecond(&args, "cycles_per_us", "number of cycles per microsecond of the trace (the clock frequency in MHz)", 1);
+
+	if (args.parse(argc, argv)){
+		args.usage(cerr);
+		return -1;
+	}
+
+	if (cyclesPerMicrosecond.getValue() <= 0){
+		error("The number of cycles per microsecond must be greater than 0");
+	}
+
+	EventLogReader reader(inputFile.getValue());
+	const vector<string>& tracks = reader.getTracks();
+	const vector<string>& names = reader.getNames();
+
+	ofstream out(outputFile.getValue().c_str());
+	if (!out.is_open()){
+		error("Could not open output file '%s'", outputFile.getValue().c_str());
+	}
+	out.setf(ios::fixed);
+	out.precision(3);
+
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	for (unsigned t = 0; t < tracks.size(); t++){
+		out << (t == 0 ? "" : ",\n") << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << t << ",\"args\":{\"name\":";
+		writeString(out, tracks[t]);
+		out << "}}";
+	}
+
+	EventLogRecord rec;
+	uint64 slice = 0;
+	while (reader.read(&rec)){
+		if (rec.end < start.getValue() || rec.start >= end.getValue()){
+			continue;
+		}
+		//each slice gets its own id, as the ids of requests are reused
+		for (unsigned i = 0; i < 2; i++){
+			out << ",\n{\"name\":";
+			writeString(out, names[rec.name]);
+			out << ",\"cat\":";
+			writeString(out, tracks[rec.track]);
+			out << ",\"ph\":\"" << (i == 0 ? 'b' : 'e') << "\",\"id\":" << slice << ",\"pid\":" << rec.track << ",\"tid\":0,\"ts\":";
+			out << (i == 0 ? rec.start : rec.end) / cyclesPerMicrosecond.getValue();
+			if (i == 0){
+				out << ",\"args\":{\"id\":\"0x" << hex << rec.id << "\",\"addr\":\"0x" << rec.addr << dec << "\",\"cycles\":" << rec.end - rec.start << "}";
+			}
+			out << "}";
+		}
+		slice++;
+	}
+	out << "\n]}\n";
+
+	out.close();
+	if (out.fail()){
+		error("Error writing output file '%s'", outputFile.getValue().c_str());
+	}
+
+	return 0;
+}